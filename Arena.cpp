@@ -0,0 +1,57 @@
+#include "Arena.h"
+#include "Exceptions.h"
+#include <cstring>
+
+Arena::Arena(qsizetype block_size)
+	: block_size_(block_size)
+	, current_(-1)
+	, pos_(0)
+	, large_bytes_(0)
+	, used_bytes_(0)
+{
+	if (block_size_<1024) THROW(ArgumentException, "Invalid arena block size " + QString::number(block_size_) + " - at least 1024 bytes are required!");
+}
+
+char* Arena::allocate(qsizetype size, qsizetype alignment)
+{
+	if (size<=0) return nullptr;
+	used_bytes_ += size;
+
+	//large allocations get a block of their own to avoid wasting the rest of the current block
+	if (size>block_size_/4)
+	{
+		large_blocks_.emplace_back(new char[size]);
+		large_bytes_ += size;
+		return large_blocks_.back().get();
+	}
+
+	//continue with the next block if the current block is full
+	qsizetype offset = (pos_ + alignment - 1) & ~(alignment - 1);
+	if (current_==-1 || offset+size>block_size_)
+	{
+		++current_;
+		if (current_==static_cast<int>(blocks_.size())) blocks_.emplace_back(new char[block_size_]);
+		offset = 0;
+	}
+	pos_ = offset + size;
+
+	return blocks_[current_].get() + offset;
+}
+
+QByteArrayView Arena::store(QByteArrayView data)
+{
+	if (data.isEmpty()) return QByteArrayView();
+
+	char* target = allocate(data.size());
+	memcpy(target, data.data(), data.size());
+	return QByteArrayView(target, data.size());
+}
+
+void Arena::clear()
+{
+	large_blocks_.clear();
+	large_bytes_ = 0;
+	current_ = -1;
+	pos_ = 0;
+	used_bytes_ = 0;
+}
@@ -0,0 +1,54 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "cppCORE_global.h"
+#include <QByteArrayView>
+#include <memory>
+#include <vector>
+
+/**
+  @brief Arena (bump) allocator for many small allocations with the same lifetime, e.g. the fields of parsed lines.
+
+  Memory is handed out from large blocks and released at once by clear() or the destructor.
+  clear() keeps the blocks for re-use, so that processing batch after batch does not allocate again.
+  The arena is not thread-safe - use one arena per thread.
+*/
+class CPPCORESHARED_EXPORT Arena
+{
+public:
+	///Constructor.
+	Arena(qsizetype block_size = 1048576);
+
+	///Allocates uninitialized memory. @p alignment must be a power of two.
+	char* allocate(qsizetype size, qsizetype alignment = 1);
+	///Copies the data into the arena. The returned view is valid until clear() is called or the arena is destroyed.
+	QByteArrayView store(QByteArrayView data);
+	///Releases all allocations at once. Blocks of the default size are kept for re-use.
+	void clear();
+
+	///Returns the memory held by the arena in bytes.
+	qint64 bytes() const
+	{
+		return static_cast<qint64>(blocks_.size()) * block_size_ + large_bytes_;
+	}
+	///Returns the memory handed out since the last call of clear() in bytes.
+	qint64 used() const
+	{
+		return used_bytes_;
+	}
+
+protected:
+	qsizetype block_size_;
+	std::vector<std::unique_ptr<char[]>> blocks_;
+	std::vector<std::unique_ptr<char[]>> large_blocks_;
+	int current_;
+	qsizetype pos_;
+	qint64 large_bytes_;
+	qint64 used_bytes_;
+
+	//declared away methods
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+};
+
+#endif // ARENA_H
@@ -41,6 +41,50 @@ void BarPlot::setValues(const QList<double>& values, const QList<QString>& label
 	}
 }
 
+PlotRenderer BarPlot::renderer()
+{
+	PlotRenderer output(1000, 400);
+	output.setXLabel(xlabel_);
+	output.setYLabel(ylabel_);
+	output.setXRange(-0.5, bars_.size() - 0.5);
+	output.setXGridVisible(false);
+	output.setLegendVisible(false);
+
+	// y range
+	if (BasicStatistics::isValidFloat(ymin_) && BasicStatistics::isValidFloat(ymax_))
+	{
+		output.setYRange(ymin_, ymax_);
+	}
+	else if (!bars_.isEmpty())
+	{
+		double ymax = *std::max_element(bars_.begin(), bars_.end());
+		output.setYRange(0, ymax * 1.1);
+	}
+
+	QStringList categories;
+	if (!labels_.isEmpty() && labels_.size() == bars_.size())
+	{
+		categories = labels_;
+	}
+	else
+	{
+		for (int i = 0; i < bars_.size(); ++i) categories << QString::number(i);
+	}
+	output.setXCategories(categories);
+
+	for (int i = 0; i < bars_.size(); ++i)
+	{
+		QString color_str = (colors_.size() > i) ? colors_[i] : "blue";
+		QColor color(color_str);
+
+		QVector<QPointF> bar;
+		bar << QPointF(i - 0.5, 0) << QPointF(i - 0.5, bars_[i]) << QPointF(i + 0.5, bars_[i]) << QPointF(i + 0.5, 0);
+		output.addArea(bar, color, color.darker());
+	}
+
+	return output;
+}
+
 void BarPlot::store(QString filename)
 {
 	if (bars_.isEmpty())
@@ -4,6 +4,7 @@
 #include "cppCORE_global.h"
 #include <QString>
 #include <QList>
+#include "PlotRenderer.h"
 
 // Creates a bar plot PNG image
 class CPPCORESHARED_EXPORT BarPlot
@@ -33,6 +34,8 @@ public:
 	}
 
 	void store(QString filename);
+	//returns a renderer for the plot, which draws it without QtCharts (see PlotRenderer)
+	PlotRenderer renderer();
 
 protected:
 	QList<double> bars_;
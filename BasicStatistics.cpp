@@ -4,10 +4,15 @@
 #include <limits>
 #include "BasicStatistics.h"
 #include "Exceptions.h"
-
-QVector<double> BasicStatistics::factorial_cache = QVector<double>();
-const int LOG_FACTORIAL_CACHE_SIZE = 120000;
-QVector<double> BasicStatistics::log_factorial_cache = QVector<double>();
+#include "QuantileSketch.h"
+#include "StatisticsKernels.h"
+#include "StatisticsAccumulator.h"
+#include <QtConcurrent>
+#include <QMutex>
+#include <QAtomicPointer>
+#include <array>
+#include <memory>
+#include <vector>
 
 double BasicStatistics::mean(const QVector<double>& data)
 {
@@ -22,7 +27,7 @@ double BasicStatistics::mean(const QVector<double>& data, int start_index, int e
 		THROW(StatisticsException, "Cannot calculate mean on empty data array.");
 	}
 
-	return std::accumulate(data.begin() + start_index, data.begin() + (end_index + 1), 0.0) / n;
+	return StatisticsKernels::sum(data.constData() + start_index, n) / n;
 }
 
 double BasicStatistics::stdev(const QVector<double>& data)
@@ -43,12 +48,7 @@ double BasicStatistics::stdev(const QVector<double>& data, double mean, int star
 		THROW(StatisticsException, "Cannot calculate standard deviation on empty data array.");
 	}
 
-	double output = 0.0;
-	for (int i=start_index; i<=end_index; ++i)
-	{
-		output += pow(data[i]-mean, 2);
-	}
-	return sqrt(output/n);
+	return sqrt(StatisticsKernels::sumSquaredDeviations(data.constData() + start_index, n, mean) / n);
 }
 
 double BasicStatistics::median(const QVector<double>& data, bool check_sorted)
@@ -81,8 +81,7 @@ double BasicStatistics::mad(const QVector<double>& data, double median)
 	{
 		devs.append(fabs(value-median));
 	}
-	std::sort(devs.begin(), devs.end());
-	return BasicStatistics::median(devs, false);
+	return medianUnsorted(devs);
 }
 
 double BasicStatistics::q1(const QVector<double>& data, bool check_sorted)
@@ -115,6 +114,204 @@ double BasicStatistics::q3(const QVector<double>& data, bool check_sorted)
 	return data[3*n/4];
 }
 
+double BasicStatistics::approximateMedian(const QVector<double>& data, double compression)
+{
+	QuantileSketch sketch(compression);
+	sketch.add(data);
+	return sketch.median();
+}
+
+double BasicStatistics::approximateQ1(const QVector<double>& data, double compression)
+{
+	QuantileSketch sketch(compression);
+	sketch.add(data);
+	return sketch.q1();
+}
+
+double BasicStatistics::approximateQ3(const QVector<double>& data, double compression)
+{
+	QuantileSketch sketch(compression);
+	sketch.add(data);
+	return sketch.q3();
+}
+
+double BasicStatistics::approximateMad(const QVector<double>& data, double median, double compression)
+{
+	QuantileSketch sketch(compression);
+	foreach(double value, data)
+	{
+		sketch.add(fabs(value-median));
+	}
+	return sketch.median();
+}
+
+//Selects the elements with the given ranks in place, i.e. afterwards they are at the same position as in the sorted data. Ranks have to be unique, sorted and relative to 'begin'.
+static void multiSelect(double* begin, double* end, const qint64* ranks_begin, const qint64* ranks_end, qint64 offset)
+{
+	if (ranks_begin==ranks_end) return;
+
+	//select the middle rank, then the ranks left and right of it in the respective partitions only
+	const qint64* middle = ranks_begin + (ranks_end - ranks_begin) / 2;
+	double* nth = begin + (*middle - offset);
+	std::nth_element(begin, nth, end);
+	multiSelect(begin, nth, ranks_begin, middle, offset);
+	multiSelect(nth + 1, end, middle + 1, ranks_end, offset + (nth + 1 - begin));
+}
+
+//Parallel sample-select: a sample is used to determine a narrow value range around each rank, then the input is scanned in parallel to count the values below the range and collect the values inside the range.
+//Returns false for a rank if it is not inside its range (unlikely), which has to be handled by the caller.
+static QVector<bool> parallelSelect(const QVector<double>& data, const QVector<qint64>& ranks, int threads, QVector<double>& output)
+{
+	const qint64 n = data.count();
+
+	//determine value ranges from a deterministic sample
+	const qint64 sample_size = std::min(n, std::max(qint64(10000), static_cast<qint64>(std::sqrt(static_cast<double>(n)))));
+	QVector<double> sample;
+	sample.reserve(sample_size);
+	for (qint64 i=0; i<sample_size; ++i)
+	{
+		sample << data[i * n / sample_size];
+	}
+	std::sort(sample.begin(), sample.end());
+
+	const qint64 margin = static_cast<qint64>(3.0 * std::sqrt(static_cast<double>(sample_size))) + 1;
+	QVector<double> lower;
+	QVector<double> upper;
+	foreach(qint64 rank, ranks)
+	{
+		qint64 pos = rank * sample_size / n;
+		lower << (pos-margin<0 ? -std::numeric_limits<double>::infinity() : sample[pos-margin]);
+		upper << (pos+margin>=sample_size ? std::numeric_limits<double>::infinity() : sample[pos+margin]);
+	}
+
+	//count values below the range and collect values inside the range per chunk
+	struct ChunkResult
+	{
+		QVector<qint64> below;
+		QVector<QVector<double>> inside;
+	};
+	QList<QFuture<ChunkResult>> futures;
+	for (int t=0; t<threads; ++t)
+	{
+		qint64 start = n * t / threads;
+		qint64 end = n * (t+1) / threads;
+		futures << QtConcurrent::run([&data, &lower, &upper, start, end]()
+		{
+			ChunkResult result;
+			result.below.fill(0, lower.count());
+			result.inside.resize(lower.count());
+			for (qint64 i=start; i<end; ++i)
+			{
+				const double value = data[i];
+				for (int r=0; r<lower.count(); ++r)
+				{
+					if (value<lower[r]) ++result.below[r];
+					else if (value<=upper[r]) result.inside[r] << value;
+				}
+			}
+			return result;
+		});
+	}
+
+	QVector<qint64> below(ranks.count(), 0);
+	QVector<QVector<double>> inside(ranks.count());
+	for (int t=0; t<futures.count(); ++t)
+	{
+		ChunkResult result = futures[t].result();
+		for (int r=0; r<ranks.count(); ++r)
+		{
+			below[r] += result.below[r];
+			inside[r] << result.inside[r];
+		}
+	}
+
+	//select inside the ranges
+	QVector<bool> found(ranks.count(), false);
+	for (int r=0; r<ranks.count(); ++r)
+	{
+		qint64 index = ranks[r] - below[r];
+		if (index<0 || index>=inside[r].count()) continue;
+
+		std::nth_element(inside[r].begin(), inside[r].begin() + index, inside[r].end());
+		output[r] = inside[r][index];
+		found[r] = true;
+	}
+
+	return found;
+}
+
+QVector<double> BasicStatistics::orderStatistics(const QVector<double>& data, QVector<qint64> ranks, int threads)
+{
+	const qint64 n = data.count();
+	foreach(qint64 rank, ranks)
+	{
+		if (rank<0 || rank>=n) THROW(StatisticsException, "Cannot select rank " + QString::number(rank) + " from data array with " + QString::number(n) + " elements!");
+	}
+
+	QVector<double> output(ranks.count());
+
+	//parallel sample-select for large arrays - the serial path below handles ranks that are not found
+	QVector<bool> found(ranks.count(), false);
+	if (threads>1 && n>=1000000)
+	{
+		found = parallelSelect(data, ranks, threads, output);
+	}
+	QVector<qint64> missing;
+	for (int r=0; r<ranks.count(); ++r)
+	{
+		if (!found[r]) missing << ranks[r];
+	}
+	if (missing.isEmpty()) return output;
+
+	//serial multi-select on scratch copy
+	std::sort(missing.begin(), missing.end());
+	missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+	QVector<double> scratch = data;
+	multiSelect(scratch.data(), scratch.data() + n, missing.constData(), missing.constData() + missing.count(), 0);
+	for (int r=0; r<ranks.count(); ++r)
+	{
+		if (!found[r]) output[r] = scratch[ranks[r]];
+	}
+
+	return output;
+}
+
+double BasicStatistics::medianUnsorted(const QVector<double>& data, int threads)
+{
+	const int n = data.count();
+	if (n==0)
+	{
+		THROW(StatisticsException, "Cannot calculate median on empty data array!");
+	}
+
+	if (n%2==0)
+	{
+		QVector<double> values = orderStatistics(data, QVector<qint64>() << n/2-1 << n/2, threads);
+		return 0.5 * (values[0] + values[1]);
+	}
+	else
+	{
+		return orderStatistics(data, QVector<qint64>() << n/2, threads)[0];
+	}
+}
+
+QVector<double> BasicStatistics::quartilesUnsorted(const QVector<double>& data, int threads)
+{
+	const int n = data.count();
+	if (n==0)
+	{
+		THROW(StatisticsException, "Cannot calculate quartiles on empty data array!");
+	}
+
+	QVector<qint64> ranks;
+	ranks << n/4 << 3*n/4 << n/2;
+	if (n%2==0) ranks << n/2-1;
+	QVector<double> values = orderStatistics(data, ranks, threads);
+
+	double median = n%2==0 ? 0.5 * (values[2] + values[3]) : values[2];
+	return QVector<double>() << values[0] << median << values[1];
+}
+
 double BasicStatistics::correlation(const QVector<double>& x, const QVector<double>& y)
 {
 	return correlation(x, y, 0, x.size()-1);
@@ -135,11 +332,7 @@ double BasicStatistics::correlation(const QVector<double>& x, const QVector<doub
 
 	const double y_mean = mean(y, start_index, end_index);
 
-	double sum = 0.0;
-	for(int i=start_index; i<=end_index; ++i)
-	{
-		sum += (x[i]-x_mean) * (y[i]-y_mean);
-	}
+	double sum = StatisticsKernels::sumProductDeviations(x.constData() + start_index, y.constData() + start_index, end_index - start_index + 1, x_mean, y_mean);
 
 	return sum / stdev(x, x_mean, start_index, end_index) / stdev(y, y_mean, start_index, end_index) / (end_index - start_index + 1);
 }
@@ -186,40 +379,18 @@ int BasicStatistics::sign(int val)
 
 QPair<double, double> BasicStatistics::linearRegression(const QVector<double>& x, const QVector<double>& y)
 {
-	// initializing sum of x and y values
-	int count_valid = 0;
+	// sums of valid x and y values
 	double sum_x = 0.0;
 	double sum_y = 0.0;
-	for (int i=0; i<x.size(); ++i)
-	{
-		if (isValidFloat(x[i]) && isValidFloat(y[i]))
-		{
-			sum_x += x[i];
-			sum_y += y[i];
-			++count_valid;
-		}
-	}
+	qint64 count_valid = StatisticsKernels::validPairSums(x.constData(), y.constData(), x.size(), sum_x, sum_y);
 
 	// middle index of the section
 	double sxoss = sum_x / count_valid;
 
-	// initializing b
+	// st2 is the sum of the squares of the distance t from the average, slope is the sum of datapoints weighted by t
 	double slope = 0.0;
 	double st2 = 0.0;
-	for (int i=0; i<x.size(); ++i)
-	{
-		if (isValidFloat(x[i]) && isValidFloat(y[i]))
-		{
-			// t is distance from the middle index
-			double t = x[i]-sxoss;
-
-			// sum of the squares of the distance from the average
-			st2 += t*t;
-
-			// b is sum of datapoints weighted by the distance
-			slope += t * y[i];
-		}
-	}
+	StatisticsKernels::regressionSums(x.constData(), y.constData(), x.size(), sxoss, st2, slope);
 
 	// averaging b by the maximum distance from the average
 	slope /= st2;
@@ -233,104 +404,271 @@ QPair<double, double> BasicStatistics::linearRegression(const QVector<double>& x
 
 QPair<double, double> BasicStatistics::getMinMax(const QVector<double>& data)
 {
-	double min = std::numeric_limits<double>::max();
-	double max = -std::numeric_limits<double>::max();
-	foreach(double v, data)
+	double min = 0.0;
+	double max = 0.0;
+	StatisticsKernels::minMax(data.constData(), data.count(), min, max);
+
+	return qMakePair(min, max);
+}
+
+//Processes data in chunks of BasicStatistics::PARALLEL_CHUNK_SIZE (or @p chunk_size) on a thread pool. Returns the chunk results in chunk order.
+template<typename T, typename TFunction>
+static QVector<T> processChunks(qint64 n, int threads, TFunction function, qint64 chunk_size = BasicStatistics::PARALLEL_CHUNK_SIZE)
+{
+	const qint64 chunk_count = (n + chunk_size - 1) / chunk_size;
+	QVector<T> output(chunk_count);
+	QVector<qint64> chunks;
+	for (qint64 c=0; c<chunk_count; ++c)
 	{
-		if (!isValidFloat(v)) continue;
+		chunks << c;
+	}
 
-		min = std::min(min, v);
-		max = std::max(max, v);
+	auto processChunk = [&](qint64 c)
+	{
+		qint64 start = c * chunk_size;
+		qint64 size = std::min(chunk_size, n - start);
+		output[c] = function(start, size);
+	};
+	if (threads<=0)
+	{
+		QtConcurrent::blockingMap(chunks, processChunk);
+	}
+	else
+	{
+		QThreadPool pool;
+		pool.setMaxThreadCount(threads);
+		QtConcurrent::blockingMap(&pool, chunks, processChunk);
 	}
 
-	return qMakePair(min, max);
+	return output;
 }
 
-void BasicStatistics::precalculateFactorials()
+//Returns if the parallel path is used
+static bool useParallel(qint64 n)
 {
-	if (!factorial_cache.isEmpty()) return;
+	return n>=BasicStatistics::PARALLEL_MIN_CHUNKS * BasicStatistics::PARALLEL_CHUNK_SIZE;
+}
 
-	//calculate factorials until double overflow happens
-	int i = 0;
-	double value = 1.0;
-	while(isValidFloat(value))
+//Returns the moments of the data merged over chunks (invalid values are not skipped like in mean/stdev)
+static StatisticsAccumulator chunkedMoments(const QVector<double>& data, int threads)
+{
+	const double* values = data.constData();
+	QVector<StatisticsAccumulator> partials = processChunks<StatisticsAccumulator>(data.count(), threads, [values](qint64 start, qint64 size)
+	{
+		double mean = StatisticsKernels::sum(values + start, size) / size;
+		return StatisticsAccumulator::fromMoments(size, mean, StatisticsKernels::sumSquaredDeviations(values + start, size, mean));
+	});
+
+	StatisticsAccumulator output;
+	foreach(const StatisticsAccumulator& partial, partials)
 	{
-		factorial_cache.append(value);
-		++i;
-		value *= i;
+		output.merge(partial);
 	}
+	return output;
 }
 
-double BasicStatistics::factorial(int n)
+double BasicStatistics::meanParallel(const QVector<double>& data, int threads)
 {
-	//outside of valid ragen => exception
-	if (n<0 || factorial_cache.count()==0)
+	if (!useParallel(data.count())) return mean(data);
+
+	const double* values = data.constData();
+	QVector<double> sums = processChunks<double>(data.count(), threads, [values](qint64 start, qint64 size)
+	{
+		return StatisticsKernels::sum(values + start, size);
+	});
+
+	return StatisticsKernels::sum(sums.constData(), sums.count()) / data.count();
+}
+
+double BasicStatistics::stdevParallel(const QVector<double>& data, int threads)
+{
+	if (!useParallel(data.count())) return stdev(data);
+
+	return chunkedMoments(data, threads).stdev();
+}
+
+double BasicStatistics::correlationParallel(const QVector<double>& x, const QVector<double>& y, int threads)
+{
+	if (x.count()!=y.count())
 	{
-		THROW(ProgrammingException, "Cannot calculate factorial of " + QByteArray::number(n) + "! Cache not initialized?");
+		THROW(StatisticsException, "Cannot calculate correlation of data arrays with different length!");
 	}
+	if (!useParallel(x.count())) return correlation(x, y);
 
-	//not in cache (i.e. double overflow) => NAN
-	if (factorial_cache.count()<n+1)
+	const double* x_values = x.constData();
+	const double* y_values = y.constData();
+	QVector<CovarianceAccumulator> partials = processChunks<CovarianceAccumulator>(x.count(), threads, [x_values, y_values](qint64 start, qint64 size)
 	{
-		return std::numeric_limits<double>::quiet_NaN();
+		const double* cx = x_values + start;
+		const double* cy = y_values + start;
+		double mean_x = StatisticsKernels::sum(cx, size) / size;
+		double mean_y = StatisticsKernels::sum(cy, size) / size;
+		return CovarianceAccumulator::fromMoments(size, mean_x, mean_y, StatisticsKernels::sumSquaredDeviations(cx, size, mean_x), StatisticsKernels::sumSquaredDeviations(cy, size, mean_y), StatisticsKernels::sumProductDeviations(cx, cy, size, mean_x, mean_y));
+	});
+
+	CovarianceAccumulator output;
+	foreach(const CovarianceAccumulator& partial, partials)
+	{
+		output.merge(partial);
 	}
+	return output.correlation();
+}
+
+QPair<double, double> BasicStatistics::getMinMaxParallel(const QVector<double>& data, int threads)
+{
+	if (!useParallel(data.count())) return getMinMax(data);
+
+	const double* values = data.constData();
+	QVector<QPair<double, double>> partials = processChunks<QPair<double, double>>(data.count(), threads, [values](qint64 start, qint64 size)
+	{
+		double min = 0.0;
+		double max = 0.0;
+		StatisticsKernels::minMax(values + start, size, min, max);
+		return qMakePair(min, max);
+	});
 
-	return factorial_cache[n];
+	double min = std::numeric_limits<double>::max();
+	double max = -std::numeric_limits<double>::max();
+	foreach(const auto& partial, partials)
+	{
+		min = std::min(min, partial.first);
+		max = std::max(max, partial.second);
+	}
+	return qMakePair(min, max);
 }
 
-double BasicStatistics::matchProbability(double p, int n, int count)
+QPair<double, double> BasicStatistics::linearRegressionParallel(const QVector<double>& x, const QVector<double>& y, int threads)
 {
-	//handle double overflow of factorial (approximately at 160)
-	int mismatches = count - n;
-	while(!BasicStatistics::isValidFloat(BasicStatistics::factorial(count)))
+	if (!useParallel(x.count())) return linearRegression(x, y);
+
+	//slope is sum(t*y)/sum(t*t) with t=x-mean(x), which equals the covariance divided by the variance of x
+	const double* x_values = x.constData();
+	const double* y_values = y.constData();
+	QVector<CovarianceAccumulator> partials = processChunks<CovarianceAccumulator>(x.count(), threads, [x_values, y_values](qint64 start, qint64 size)
 	{
-		n /= 2;
-		mismatches /=2;
-		count = n + mismatches;
+		const double* cx = x_values + start;
+		const double* cy = y_values + start;
+		double sum_x = 0.0;
+		double sum_y = 0.0;
+		qint64 count = StatisticsKernels::validPairSums(cx, cy, size, sum_x, sum_y);
+		if (count==0) return CovarianceAccumulator();
+
+		double mean_x = sum_x / count;
+		double sum_tt = 0.0;
+		double sum_ty = 0.0;
+		StatisticsKernels::regressionSums(cx, cy, size, mean_x, sum_tt, sum_ty);
+		return CovarianceAccumulator::fromMoments(count, mean_x, sum_y / count, sum_tt, 0.0, sum_ty);
+	});
+
+	CovarianceAccumulator output;
+	foreach(const CovarianceAccumulator& partial, partials)
+	{
+		output.merge(partial);
 	}
+	if (output.count()==0) return qMakePair(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN());
+
+	return output.linearRegression();
+}
 
-	//calculate probability
-	double output = 0.0;
-	for (int i=n; i<=count; ++i)
+//Number of factorials that fit into a double (171! overflows)
+static constexpr int FACTORIAL_TABLE_SIZE = 171;
+
+//Generates the factorial table at compile time
+static constexpr std::array<double, FACTORIAL_TABLE_SIZE> factorialTable()
+{
+	std::array<double, FACTORIAL_TABLE_SIZE> output{};
+	output[0] = 1.0;
+	for (int i=1; i<FACTORIAL_TABLE_SIZE; ++i)
 	{
-		double q = std::pow(1.0-p, count-i) * std::pow(p, i) * BasicStatistics::factorial(count) / BasicStatistics::factorial(i) / BasicStatistics::factorial(count-i);
-		output += q;
+		output[i] = output[i-1] * i;
 	}
+	return output;
+}
+
+static constexpr std::array<double, FACTORIAL_TABLE_SIZE> FACTORIALS = factorialTable();
 
-	//check that result is valid
-	if (!BasicStatistics::isValidFloat(output))
+void BasicStatistics::precalculateFactorials()
+{
+}
+
+double BasicStatistics::factorial(int n)
+{
+	//outside of valid range => exception
+	if (n<0)
 	{
-		THROW(ProgrammingException, "Calculated probabilty for " + QString::number(n) + " matches and " + QString::number(mismatches) + " mismatches is not a valid float!");
+		THROW(ProgrammingException, "Cannot calculate factorial of " + QByteArray::number(n) + "!");
 	}
 
-	return output;
+	//double overflow => NAN
+	if (n>=FACTORIAL_TABLE_SIZE)
+	{
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+	return FACTORIALS[n];
 }
 
-void BasicStatistics::precalculateLogFactorials()
+//Log factorial table. When the table has to grow, a new table of (at least) double size is published. Published tables are never modified or deleted, so readers need no lock.
+struct LogFactorialTable
 {
-	if (!log_factorial_cache.isEmpty()) return;
+	QVector<double> values;
+};
+static QMutex log_factorial_mutex;
+static QAtomicPointer<const LogFactorialTable> log_factorial_table;
+static std::vector<std::unique_ptr<const LogFactorialTable>> log_factorial_tables;
 
-	//calculate factorials until double overflow happens
+const double* BasicStatistics::logFactorialTable(int n)
+{
+	if (n>=LOG_FACTORIAL_TABLE_SIZE) return nullptr;
+
+	//fast path: current table is large enough
+	const LogFactorialTable* table = log_factorial_table.loadAcquire();
+	if (table!=nullptr && n<table->values.count()) return table->values.constData();
+
+	QMutexLocker locker(&log_factorial_mutex);
+	table = log_factorial_table.loadAcquire();
+	if (table!=nullptr && n<table->values.count()) return table->values.constData();
+
+	//create larger table, continuing the summation of the current table
+	int size = table==nullptr ? 65536 : 2 * table->values.count();
+	size = std::min(std::max(size, n+1), LOG_FACTORIAL_TABLE_SIZE);
+	LogFactorialTable* new_table = new LogFactorialTable();
+	new_table->values.resize(size);
 	int i = 0;
 	double value = 0.0;
-	while(isValidFloat(value) && (i < 100000))
+	if (table!=nullptr)
+	{
+		std::copy(table->values.cbegin(), table->values.cend(), new_table->values.begin());
+		i = table->values.count() - 1;
+		value = table->values[i];
+	}
+	new_table->values[i] = value;
+	for (++i; i<size; ++i)
 	{
-		log_factorial_cache.append(value);
-		++i;
 		value += log(i);
+		new_table->values[i] = value;
 	}
+
+	log_factorial_tables.emplace_back(new_table);
+	log_factorial_table.storeRelease(new_table);
+	return new_table->values.constData();
+}
+
+void BasicStatistics::precalculateLogFactorials(int n)
+{
+	logFactorialTable(std::min(std::max(n, 0), LOG_FACTORIAL_TABLE_SIZE-1));
 }
 
 double BasicStatistics::logFactorial(int n)
 {
 	if (n<0) THROW(ProgrammingException, "Cannot calculate log factorial of negative number " + QByteArray::number(n) + "!");
-	if(log_factorial_cache.count()==0) THROW(ProgrammingException, "Cannot calculate log factorial! Cache not initialized!");
-	if(n >= LOG_FACTORIAL_CACHE_SIZE)
-	{
-		THROW(ProgrammingException, "Cannot calculate log factorial of " + QByteArray::number(n) + "! Number exceeds cache size of " + QByteArray::number(LOG_FACTORIAL_CACHE_SIZE) + "!");
-	}
 
-	return log_factorial_cache[n];
+	const double* table = logFactorialTable(n);
+	if (table!=nullptr) return table[n];
+
+	//Stirling's series (the truncation error is far below double precision for values beyond the table)
+	double x = n;
+	return x*log(x) - x + 0.5*log(2.0*M_PI*x) + 1.0/(12.0*x) - 1.0/(360.0*x*x*x);
 }
 
 double BasicStatistics::hypergeometricLogProbability(int a, int b, int c, int d)
@@ -338,46 +676,278 @@ double BasicStatistics::hypergeometricLogProbability(int a, int b, int c, int d)
 	return logFactorial(a+b) + logFactorial(c+d) + logFactorial(a+c) + logFactorial(b+d) - logFactorial(a) - logFactorial(b) - logFactorial(c) - logFactorial(d) - logFactorial(a+b+c+d);
 }
 
-double BasicStatistics::fishersExactTest(int a, int b, int c, int d, QByteArray type)
+BasicStatistics::FisherTestType BasicStatistics::fisherTestType(const QByteArray& type)
 {
-	// check input
-	QList<QByteArray> valid_types;
-	valid_types << "two-sided" << "greater" << "less";
-	if(!valid_types.contains(type))
+	if (type=="two-sided") return FisherTestType::TWO_SIDED;
+	if (type=="greater") return FisherTestType::GREATER;
+	if (type=="less") return FisherTestType::LESS;
+
+	THROW(ArgumentException, "Invalid type '" + type + "' provided! Valid types are: 'two-sided', 'greater', 'less' ");
+}
+
+//Log factorial accessor for tables beyond the log factorial table
+struct LogFactorialFunction
+{
+	double operator[](int n) const
 	{
-		THROW(ArgumentException, "Invalid type '" + type + "' provided! Valid types are: '" + valid_types.join("', '") + "' ");
+		return BasicStatistics::logFactorial(n);
 	}
+};
+
+//Calculates the p-value of Fisher's Exact Test using a log factorial table (or LogFactorialFunction) without bounds checks.
+//Only the possible tables (non-negative cells) on the tested side are visited. The sum of the four marginal log factorials is the same for all tables, so it is hoisted out of the loop.
+//The remaining terms are evaluated in the same order as in hypergeometricLogProbability(), which makes the p-values bit-identical to the original implementation.
+//Note: a multiplicative hypergeometric recurrence (p(i+1) = p(i) * ratio) would avoid the table lookups, but its rounding drift can flip the '<= cutoff' decision of the two-sided test, i.e. change p-values. Thus, each term is calculated from four table lookups.
+template<typename TLogFactorial>
+static double fishersExactTestCore(const TLogFactorial& lf, int a, int b, int c, int d, BasicStatistics::FisherTestType type)
+{
+	const int n = a + b + c + d;
+	const double log_marginals = lf[a+b] + lf[c+d] + lf[a+c] + lf[b+d];
+	const double log_n = lf[n];
+	const double log_p_cutoff = log_marginals - lf[a] - lf[b] - lf[c] - lf[d] - log_n + 1e-12; //add small offset to ensure '<=' operation below works even with double precision
+
+	int i_min = std::max(0, a-d);
+	int i_max = std::min(a+b, a+c);
+	if (type==BasicStatistics::FisherTestType::GREATER) i_min = a;
+	if (type==BasicStatistics::FisherTestType::LESS) i_max = a;
+
+	double p_fraction = 0.0;
+	if (type==BasicStatistics::FisherTestType::TWO_SIDED)
+	{
+		for (int i=i_min; i<=i_max; ++i)
+		{
+			double log_p = log_marginals - lf[i] - lf[a+b-i] - lf[a+c-i] - lf[d-a+i] - log_n;
+			if (log_p <= log_p_cutoff) p_fraction += exp(log_p - log_p_cutoff);
+		}
+	}
+	else
+	{
+		for (int i=i_min; i<=i_max; ++i)
+		{
+			double log_p = log_marginals - lf[i] - lf[a+b-i] - lf[a+c-i] - lf[d-a+i] - log_n;
+			p_fraction += exp(log_p - log_p_cutoff);
+		}
+	}
+
+	return std::min(1.0, exp(log_p_cutoff + log(p_fraction)));
+}
+
+double BasicStatistics::fishersExactTest(int a, int b, int c, int d, QByteArray type)
+{
+	return fishersExactTest(a, b, c, d, fisherTestType(type));
+}
+
+double BasicStatistics::fishersExactTest(int a, int b, int c, int d, FisherTestType type)
+{
+	// check input
 	if(a<0 || b<0 || c<0 || d<0)
 	{
 		THROW(ArgumentException, "Cannot perform Fisher's Exact Test on negative counts!");
 	}
 
-	precalculateLogFactorials();
+	qint64 n = qint64(a) + b + c + d;
+	if (n>std::numeric_limits<int>::max())
+	{
+		THROW(ArgumentException, "Cannot perform Fisher's Exact Test on counts with a sum of " + QByteArray::number(n) + "!");
+	}
 
-	int n = a + b + c + d;
-	double log_p_cutoff = hypergeometricLogProbability(a, b, c, d) + 1e-12; //add small offset to ensure '<=' operation below works even with double precision
-	double p_fraction = 0.0;
+	const double* table = logFactorialTable(n);
+	if (table==nullptr) return fishersExactTestCore(LogFactorialFunction(), a, b, c, d, type);
+	return fishersExactTestCore(table, a, b, c, d, type);
+}
+
+QVector<double> BasicStatistics::fishersExactTest(const QVector<int>& a, const QVector<int>& b, const QVector<int>& c, const QVector<int>& d, FisherTestType type, int threads)
+{
+	// check input
+	const int count = a.count();
+	if (b.count()!=count || c.count()!=count || d.count()!=count)
+	{
+		THROW(ArgumentException, "Cannot perform Fisher's Exact Test on count arrays with different length!");
+	}
+
+	qint64 n_max = 0;
+	for (int i=0; i<count; ++i)
+	{
+		if(a[i]<0 || b[i]<0 || c[i]<0 || d[i]<0)
+		{
+			THROW(ArgumentException, "Cannot perform Fisher's Exact Test on negative counts!");
+		}
+		n_max = std::max(n_max, qint64(a[i]) + b[i] + c[i] + d[i]);
+	}
+	if (n_max>std::numeric_limits<int>::max())
+	{
+		THROW(ArgumentException, "Cannot perform Fisher's Exact Test on counts with a sum of " + QByteArray::number(n_max) + "!");
+	}
 
-	for (int i = 0; i <= n; ++i)
+	//grow the log factorial table once before the parallel part
+	QVector<double> output(count);
+	const double* table = logFactorialTable(n_max);
+	double* p_values = output.data();
+	auto processTables = [&](qint64 start, qint64 size)
 	{
-		if ((a+b-i >= 0) && (a+c-i >= 0) && (d-a+i >= 0))
+		for (qint64 i=start; i<start+size; ++i)
 		{
-			double log_p = hypergeometricLogProbability(i, a+b-i, a+c-i, d-a+i);
+			p_values[i] = table!=nullptr ? fishersExactTestCore(table, a[i], b[i], c[i], d[i], type) : fishersExactTestCore(LogFactorialFunction(), a[i], b[i], c[i], d[i], type);
+		}
+		return 0;
+	};
 
-			if ((type == "two-sided") && (log_p <= log_p_cutoff))
-			{
-				p_fraction += exp(log_p - log_p_cutoff);
-			}
-			else if((type == "greater") && (i >= a))
-			{
-				p_fraction += exp(log_p - log_p_cutoff);
-			}
-			else if((type == "less") && (i <= a))
-			{
-				p_fraction += exp(log_p - log_p_cutoff);
-			}
+	if (count<2*BATCH_CHUNK_SIZE || threads==1)
+	{
+		processTables(0, count);
+	}
+	else
+	{
+		processChunks<int>(count, threads, processTables, BATCH_CHUNK_SIZE);
+	}
+
+	return output;
+}
+
+//Returns the error of Stirling's formula log(n!) - log(sqrt(2*pi*n)*(n/e)^n) for n>0
+static double stirlingError(int n)
+{
+	static const std::array<double, 16> small_values = []()
+	{
+		std::array<double, 16> output{};
+		double log_factorial = 0.0;
+		for (int i=1; i<16; ++i)
+		{
+			log_factorial += log(i);
+			output[i] = log_factorial - (i + 0.5) * log(i) + i - 0.5 * log(2.0 * M_PI);
+		}
+		return output;
+	}();
+	if (n<16) return small_values[n];
+
+	const double s0 = 1.0/12.0;
+	const double s1 = 1.0/360.0;
+	const double s2 = 1.0/1260.0;
+	const double s3 = 1.0/1680.0;
+	const double s4 = 1.0/1188.0;
+	const double nn = double(n) * n;
+	if (n>500) return (s0 - s1/nn) / n;
+	if (n>80) return (s0 - (s1 - s2/nn)/nn) / n;
+	if (n>35) return (s0 - (s1 - (s2 - s3/nn)/nn)/nn) / n;
+	return (s0 - (s1 - (s2 - (s3 - s4/nn)/nn)/nn)/nn) / n;
+}
+
+//Returns the deviance term x*log(x/np) + np - x, using a series if x is close to np to avoid cancellation
+static double binomialDeviance(double x, double np)
+{
+	if (std::fabs(x - np) < 0.1 * (x + np))
+	{
+		double v = (x - np) / (x + np);
+		double s = (x - np) * v;
+		double ej = 2.0 * x * v;
+		v = v * v;
+		for (int j=1; j<1000; ++j)
+		{
+			ej *= v;
+			double s_next = s + ej / (2*j + 1);
+			if (s_next==s) return s;
+			s = s_next;
 		}
 	}
+	return x * log(x / np) + np - x;
+}
 
-	return std::min(1.0, exp(log_p_cutoff + log(p_fraction)));
+//Returns the log probability of k matches in n observations, using the saddle point expansion of Loader (2000).
+//In contrast to log factorial differences, there is no cancellation of large terms, so the result is accurate to a few ulps also for large n.
+static double binomialLogProbability(int k, int n, double p, double q)
+{
+	if (k==0) return n * log1p(-p);
+	if (k==n) return n * log(p);
+
+	double log_c = stirlingError(n) - stirlingError(k) - stirlingError(n-k) - binomialDeviance(k, n*p) - binomialDeviance(n-k, n*q);
+	return log_c - 0.5 * (log(2.0 * M_PI) + log(double(k)) + log1p(-double(k)/n));
+}
+
+//Calculates the binomial tail P(X>=n) for X~B(count, p) in log space.
+//The summation starts at the term next to the mode and uses the term recurrence away from it, so the terms decrease and the loop stops when they are negligible.
+//If n is above the mode, the upper tail is summed. Otherwise, the lower tail is summed and subtracted from 1 (the result is larger than ~0.5 in that case, so there is no cancellation).
+static double binomialUpperTail(double p, int n, int count)
+{
+	if (n<=0) return 1.0;
+	if (n>count || p<=0.0) return 0.0;
+	if (p>=1.0) return 1.0;
+
+	const double q = 1.0 - p;
+	const double odds = p / q;
+	double sum = 1.0;
+	double term = 1.0;
+	if (n > (count + 1.0) * p)
+	{
+		for (int k=n; k<count; ++k)
+		{
+			term *= (count - k) / (k + 1.0) * odds;
+			sum += term;
+			if (term < sum * 1e-17) break;
+		}
+		return std::min(1.0, exp(binomialLogProbability(n, count, p, q) + log(sum)));
+	}
+
+	for (int k=n-1; k>0; --k)
+	{
+		term *= k / ((count - k + 1.0) * odds);
+		sum += term;
+		if (term < sum * 1e-17) break;
+	}
+	return std::max(0.0, 1.0 - exp(binomialLogProbability(n-1, count, p, q) + log(sum)));
+}
+
+//Checks the arguments of matchProbability
+static void checkMatchProbabilityArguments(double p, int n, int count)
+{
+	if (!(p>=0.0 && p<=1.0))
+	{
+		THROW(ArgumentException, "Invalid match probability " + QString::number(p) + "! Must be in range [0, 1].");
+	}
+	if (count<0)
+	{
+		THROW(ArgumentException, "Invalid observation count " + QString::number(count) + "!");
+	}
+}
+
+double BasicStatistics::matchProbability(double p, int n, int count)
+{
+	checkMatchProbabilityArguments(p, n, count);
+
+	return binomialUpperTail(p, n, count);
+}
+
+QVector<double> BasicStatistics::matchProbability(const QVector<double>& p, const QVector<int>& n, const QVector<int>& count, int threads)
+{
+	// check input
+	const int size = p.count();
+	if (n.count()!=size || count.count()!=size)
+	{
+		THROW(ArgumentException, "Cannot calculate match probabilities of arrays with different length!");
+	}
+	for (int i=0; i<size; ++i)
+	{
+		checkMatchProbabilityArguments(p[i], n[i], count[i]);
+	}
+
+	QVector<double> output(size);
+	double* probabilities = output.data();
+	auto processQueries = [&](qint64 start, qint64 chunk_size)
+	{
+		for (qint64 i=start; i<start+chunk_size; ++i)
+		{
+			probabilities[i] = binomialUpperTail(p[i], n[i], count[i]);
+		}
+		return 0;
+	};
+
+	if (size<2*BATCH_CHUNK_SIZE || threads==1)
+	{
+		processQueries(0, size);
+	}
+	else
+	{
+		processChunks<int>(size, threads, processQueries, BATCH_CHUNK_SIZE);
+	}
+
+	return output;
 }
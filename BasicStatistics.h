@@ -2,8 +2,14 @@
 #define BASICSTATISTICS_H
 
 #include "cppCORE_global.h"
+#include "Exceptions.h"
+#include "DataView.h"
+#include "StatisticsKernels.h"
 #include <QVector>
 #include <QPair>
+#include <cmath>
+#include <limits>
+#include <type_traits>
 
 ///Statistics helper class.
 class CPPCORESHARED_EXPORT BasicStatistics
@@ -27,11 +33,142 @@ public:
 	static double q1(const QVector<double>& data, bool check_sorted=false);
 	///Calculates the third quartile from sorted data.
 	static double q3(const QVector<double>& data, bool check_sorted=false);
+	///Calculates the approximate median of unsorted data using a QuantileSketch, i.e. without sorting or copying the data.
+	static double approximateMedian(const QVector<double>& data, double compression = 200.0);
+	///Calculates the approximate first quartile of unsorted data using a QuantileSketch.
+	static double approximateQ1(const QVector<double>& data, double compression = 200.0);
+	///Calculates the approximate third quartile of unsorted data using a QuantileSketch.
+	static double approximateQ3(const QVector<double>& data, double compression = 200.0);
+	///Calculates the approximate median average deviation of unsorted data using a QuantileSketch.
+	static double approximateMad(const QVector<double>& data, double median, double compression = 200.0);
+	///Returns the values at the given 0-based ranks of the data as if it were sorted, using a multi-select on a scratch copy (expected linear time, no full sort).
+	///All ranks are selected in one pass. If @p threads is greater than 1, large arrays are processed by a parallel sample-select. The data must not contain NaN values.
+	static QVector<double> orderStatistics(const QVector<double>& data, QVector<qint64> ranks, int threads = 1);
+	///Calculates the median of unsorted data without sorting it. The result is identical to median() of the sorted data.
+	static double medianUnsorted(const QVector<double>& data, int threads = 1);
+	///Calculates the first quartile, median and third quartile of unsorted data in one multi-select pass. The results are identical to q1(), median() and q3() of the sorted data.
+	static QVector<double> quartilesUnsorted(const QVector<double>& data, int threads = 1);
 	///Calculates the correlation of two data arrays.
 	static double correlation(const QVector<double>& x, const QVector<double>& y);
 	///Calculates the correlation of two data arrays in sub-range of indices.
 	static double correlation(const QVector<double>& x, const QVector<double>& y, int start_index, int end_index);
 
+	///Calculates the sum of numeric data in an existing buffer (e.g. int, float or strided data) without conversion copy.
+	///Integers of up to 32 bits are summed exactly. Other types are summed in double precision with Kahan compensation (contiguous double data uses the SIMD kernels).
+	template<typename T>
+	static double sum(DataView<T> data)
+	{
+		if constexpr (std::is_same_v<T, double>)
+		{
+			if (data.isContiguous()) return StatisticsKernels::sum(data.data(), data.size());
+		}
+		if constexpr (std::is_integral_v<T> && sizeof(T)<=4)
+		{
+			qint64 output = 0;
+			for (qint64 i=0; i<data.size(); ++i)
+			{
+				output += data[i];
+			}
+			return output;
+		}
+		return kahanSum(data, [](double value){ return value; });
+	}
+	///Calculates the mean of numeric data in an existing buffer (e.g. int, float or strided data) without conversion copy.
+	template<typename T>
+	static double mean(DataView<T> data)
+	{
+		if (data.isEmpty())
+		{
+			THROW(StatisticsException, "Cannot calculate mean on empty data array.");
+		}
+
+		return sum(data) / data.size();
+	}
+	///Calculates the standard deviation of numeric data in an existing buffer (e.g. int, float or strided data), using a given mean.
+	template<typename T>
+	static double stdev(DataView<T> data, double mean)
+	{
+		if (data.isEmpty())
+		{
+			THROW(StatisticsException, "Cannot calculate standard deviation on empty data array.");
+		}
+
+		if constexpr (std::is_same_v<T, double>)
+		{
+			if (data.isContiguous()) return std::sqrt(StatisticsKernels::sumSquaredDeviations(data.data(), data.size(), mean) / data.size());
+		}
+		return std::sqrt(kahanSum(data, [mean](double value){ return (value-mean) * (value-mean); }) / data.size());
+	}
+	///Calculates the standard deviation of numeric data in an existing buffer (e.g. int, float or strided data).
+	template<typename T>
+	static double stdev(DataView<T> data)
+	{
+		return stdev(data, mean(data));
+	}
+	///Calculates the correlation of numeric data in existing buffers (e.g. int, float or strided data).
+	template<typename T>
+	static double correlation(DataView<T> x, DataView<T> y)
+	{
+		if (x.size()!=y.size())
+		{
+			THROW(StatisticsException, "Cannot calculate correlation of data arrays with different length!");
+		}
+		if (x.isEmpty())
+		{
+			THROW(StatisticsException, "Cannot calculate correlation of data arrays with zero length!");
+		}
+
+		const double x_mean = mean(x);
+		const double y_mean = mean(y);
+		if constexpr (std::is_same_v<T, double>)
+		{
+			if (x.isContiguous() && y.isContiguous())
+			{
+				return StatisticsKernels::sumProductDeviations(x.data(), y.data(), x.size(), x_mean, y_mean) / stdev(x, x_mean) / stdev(y, y_mean) / x.size();
+			}
+		}
+
+		double sum = 0.0;
+		double c = 0.0;
+		for (qint64 i=0; i<x.size(); ++i)
+		{
+			double term = (x[i]-x_mean) * (y[i]-y_mean) - c;
+			double t = sum + term;
+			c = isValidFloat(t) ? (t - sum) - term : 0.0;
+			sum = t;
+		}
+		return sum / stdev(x, x_mean) / stdev(y, y_mean) / x.size();
+	}
+	///Returns minimum and maximum of numeric data in an existing buffer (e.g. int, float or strided data). Ignores invalid values.
+	template<typename T>
+	static QPair<double, double> getMinMax(DataView<T> data)
+	{
+		if constexpr (std::is_same_v<T, double>)
+		{
+			if (data.isContiguous())
+			{
+				double min = 0.0;
+				double max = 0.0;
+				StatisticsKernels::minMax(data.data(), data.size(), min, max);
+				return qMakePair(min, max);
+			}
+		}
+
+		double min = std::numeric_limits<double>::max();
+		double max = -std::numeric_limits<double>::max();
+		for (qint64 i=0; i<data.size(); ++i)
+		{
+			double value = data[i];
+			if constexpr (std::is_floating_point_v<T>)
+			{
+				if (!std::isfinite(value)) continue;
+			}
+			if (value<min) min = value;
+			if (value>max) max = value;
+		}
+		return qMakePair(min, max);
+	}
+
 	///Returns if a float is valid.
 	static bool isValidFloat(double value);
 	///Returns if a string is a representations of a valid float.
@@ -55,6 +192,22 @@ public:
 	///Returns minimum and maximum of a dataset. Ignores invalid values.
 	static QPair<double, double> getMinMax(const QVector<double>& data);
 
+	///Parallel version of mean() for large arrays (see PARALLEL_CHUNK_SIZE). If @p threads is 0, the ideal thread count is used.
+	static double meanParallel(const QVector<double>& data, int threads = 0);
+	///Parallel version of stdev() for large arrays (see PARALLEL_CHUNK_SIZE). If @p threads is 0, the ideal thread count is used.
+	static double stdevParallel(const QVector<double>& data, int threads = 0);
+	///Parallel version of correlation() for large arrays (see PARALLEL_CHUNK_SIZE). If @p threads is 0, the ideal thread count is used.
+	static double correlationParallel(const QVector<double>& x, const QVector<double>& y, int threads = 0);
+	///Parallel version of getMinMax() for large arrays (see PARALLEL_CHUNK_SIZE). If @p threads is 0, the ideal thread count is used.
+	static QPair<double, double> getMinMaxParallel(const QVector<double>& data, int threads = 0);
+	///Parallel version of linearRegression() for large arrays (see PARALLEL_CHUNK_SIZE). If @p threads is 0, the ideal thread count is used.
+	static QPair<double, double> linearRegressionParallel(const QVector<double>& x, const QVector<double>& y, int threads = 0);
+	///Chunk size of the parallel functions. The data is split into chunks of this size, independent of the thread count, and the partial moments of the chunks are merged in order.
+	///Thus, the result does not depend on the number of threads. Arrays with less than PARALLEL_MIN_CHUNKS chunks are processed by the serial functions, because the thread overhead outweighs the gain.
+	static constexpr qint64 PARALLEL_CHUNK_SIZE = 262144;
+	///Minimum number of chunks for parallel processing, see PARALLEL_CHUNK_SIZE.
+	static constexpr qint64 PARALLEL_MIN_CHUNKS = 4;
+
 	///Returns an even-spaced range of values.
 	template <typename T>
 	static QVector<T> range(int size, T start_value, T increment)
@@ -71,14 +224,17 @@ public:
 		return output;
 	}
 
-	///Precalculates factorials.
+	///Does nothing - the factorials are generated at compile time. Kept for backward compatibility.
 	static void precalculateFactorials();
 
-	///Returns the factorial of 'n', or 'nan' if an overflow happened.
+	///Returns the factorial of 'n', or 'nan' if an overflow happened (n>170).
 	static double factorial(int n);
 
 	///Returns the probability to see 'n' or more matches in 'count' observation when the probability to see a single match is 'p' (via binomial distribution)
+	///The binomial tail is calculated in log space, starting at the term closest to the mode and stopping when the terms become negligible. Thus, it is exact and fast also for large counts.
 	static double matchProbability(double p, int n, int count);
+	///Batch version of matchProbability(): the i-th probability is calculated from p[i], n[i] and count[i]. The queries are processed in parallel. If @p threads is 0, the ideal thread count is used.
+	static QVector<double> matchProbability(const QVector<double>& p, const QVector<int>& n, const QVector<int>& count, int threads = 0);
 
 	///Returns if two ranges overlap. Coordinates are 1-based.
 	static bool rangeOverlaps(int start1, int end1, int start2, int end2)
@@ -86,23 +242,59 @@ public:
 		return start1<=end2 && end1>=start2;
 	}
 
-	///Precalculates log factorials.
-	static void precalculateLogFactorials();
+	///Precalculates log factorials up to @p n. Optional, because the table grows on demand, but avoids growing the table in a hot loop.
+	static void precalculateLogFactorials(int n = 100000);
 
-	/// Returns the log factorial of 'n'
+	///Returns the log factorial of 'n'. Thread-safe.
+	///Values below LOG_FACTORIAL_TABLE_SIZE are looked up in a table that grows on demand. Larger values are calculated using Stirling's series.
 	static double logFactorial(int n);
+	///Maximum size of the log factorial table (32MB).
+	static constexpr int LOG_FACTORIAL_TABLE_SIZE = 4194304;
 
 	///Returns the log hypergeometric probability (required for Fisher's Exact Test)
 	static double hypergeometricLogProbability(int a, int b, int c, int d);
 
+	///Alternative hypothesis of Fisher's Exact Test.
+	enum class FisherTestType
+	{
+		TWO_SIDED,
+		GREATER,
+		LESS
+	};
+	///Converts a Fisher's Exact Test type string ('two-sided', 'greater' or 'less') to the enum. Throws an exception if the type is invalid.
+	static FisherTestType fisherTestType(const QByteArray& type);
+
 	///Returns the p-value of a two-sided Fisher's Exact Test
 	/// based on https://genome.sph.umich.edu/w/images/b/b3/Bios615-fa12-lec03-presentation.pdf
 	static double fishersExactTest(int a, int b, int c, int d, QByteArray type);
+	///Returns the p-value of Fisher's Exact Test. Faster than the string version, which delegates to this one.
+	static double fishersExactTest(int a, int b, int c, int d, FisherTestType type);
+	///Batch version of Fisher's Exact Test: the i-th p-value is calculated from the 2x2 table a[i], b[i], c[i], d[i].
+	///The tables are processed in parallel. The p-values are identical to those of the single-table version. If @p threads is 0, the ideal thread count is used.
+	static QVector<double> fishersExactTest(const QVector<int>& a, const QVector<int>& b, const QVector<int>& c, const QVector<int>& d, FisherTestType type, int threads = 0);
+	///Number of items processed per task by the batch functions of this class.
+	static constexpr qint64 BATCH_CHUNK_SIZE = 1024;
 
 
 protected:
-	static QVector<double> log_factorial_cache;
-	static QVector<double> factorial_cache;
+	//Kahan sum of transformed values (compensation is reset for infinite/NaN sums, like in StatisticsKernels)
+	template<typename T, typename TTransform>
+	static double kahanSum(DataView<T> data, TTransform transform)
+	{
+		double sum = 0.0;
+		double c = 0.0;
+		for (qint64 i=0; i<data.size(); ++i)
+		{
+			double y = transform(static_cast<double>(data[i])) - c;
+			double t = sum + y;
+			c = isValidFloat(t) ? (t - sum) - y : 0.0;
+			sum = t;
+		}
+		return sum;
+	}
+
+	//returns the log factorial table containing at least the values 0..n, or nullptr if n is not below LOG_FACTORIAL_TABLE_SIZE. The table is valid until the program ends.
+	static const double* logFactorialTable(int n);
 
 };
 
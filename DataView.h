@@ -0,0 +1,76 @@
+#ifndef DATAVIEW_H
+#define DATAVIEW_H
+
+#include "cppCORE_global.h"
+#include <QVector>
+#include <type_traits>
+
+/**
+  @brief Read-only view on numeric data in an existing buffer, without copying it.
+
+  The elements can be contiguous (e.g. a QVector<int> or float array) or strided (e.g. one member of an array of structs).
+  The view does not own the data, i.e. the buffer must outlive the view.
+*/
+template<typename T>
+class DataView
+{
+	static_assert(std::is_arithmetic_v<T>, "DataView requires an arithmetic element type!");
+
+public:
+	///Constructor for contiguous or strided data. @p stride is the distance of two elements in bytes (default is contiguous).
+	DataView(const T* data, qint64 size, qint64 stride = sizeof(T))
+		: data_(data)
+		, size_(size)
+		, stride_(stride)
+	{
+	}
+	///Constructor for a vector.
+	DataView(const QVector<T>& data)
+		: DataView(data.constData(), data.count())
+	{
+	}
+	///Creates a view on a member of an array of structs, e.g. DataView<int>::column(rows.constData(), rows.count(), &Row::depth).
+	template<typename S>
+	static DataView column(const S* rows, qint64 size, const T S::*member)
+	{
+		return DataView(size==0 ? nullptr : &(rows[0].*member), size, sizeof(S));
+	}
+
+	///Returns the number of elements.
+	qint64 size() const
+	{
+		return size_;
+	}
+	///Returns if the view is empty.
+	bool isEmpty() const
+	{
+		return size_==0;
+	}
+	///Returns if the elements are contiguous in memory.
+	bool isContiguous() const
+	{
+		return stride_==sizeof(T);
+	}
+	///Returns the pointer to the first element.
+	const T* data() const
+	{
+		return data_;
+	}
+	///Returns an element.
+	T operator[](qint64 i) const
+	{
+		return *reinterpret_cast<const T*>(reinterpret_cast<const char*>(data_) + i * stride_);
+	}
+	///Returns a view on a sub-range of elements.
+	DataView mid(qint64 start, qint64 size) const
+	{
+		return DataView(reinterpret_cast<const T*>(reinterpret_cast<const char*>(data_) + start * stride_), size, stride_);
+	}
+
+protected:
+	const T* data_;
+	qint64 size_;
+	qint64 stride_;
+};
+
+#endif // DATAVIEW_H
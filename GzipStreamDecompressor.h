@@ -5,7 +5,8 @@
 #include "Log.h"
 
 // This class handles the decompression of GZ data, it accepts compressed input QByteArray data
-// in chunks and produces QByteArray uncompressed data
+// in chunks and produces QByteArray uncompressed data.
+// Multi-member GZ data (e.g. BGZF) is supported.
 class GzipStreamDecompressor
 {
 public:
@@ -21,6 +22,12 @@ public:
         inflateEnd(&s_);
     }
 
+    // resets the decompression state, e.g. to start over with a new stream
+    void reset()
+    {
+        inflateReset(&s_);
+    }
+
     bool feed(const QByteArray& chunk, QByteArray& out)
     {
         s_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(chunk.constData()));
@@ -11,6 +11,11 @@
 #include <QLegend>
 #include <QLineSeries>
 #include <QAreaSeries>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QDataStream>
+#include <QMap>
 
 #include "Exceptions.h"
 #include "BasicStatistics.h"
@@ -18,10 +23,179 @@
 #include "Log.h"
 #include "Helper.h"
 
+HistogramBinning HistogramBinning::linear(double min, double max, int bins)
+{
+	if (bins<=0)
+	{
+		THROW(StatisticsException, "Cannot initialize histogram binning without bins!");
+	}
+	if (!(min<max))
+	{
+		THROW(StatisticsException, "Cannot initialize histogram binning with empty range!");
+	}
+
+	HistogramBinning output;
+	output.layout = LINEAR;
+	output.min = min;
+	output.max = max;
+	output.bins = bins;
+	output.offset = min;
+	output.scale = bins / (max-min);
+	return output;
+}
+
+HistogramBinning HistogramBinning::logarithmic(double min, double max, int bins_per_decade)
+{
+	if (bins_per_decade<=0)
+	{
+		THROW(StatisticsException, "Cannot initialize logarithmic histogram binning with non-positive bins per decade!");
+	}
+	if (min<=0)
+	{
+		THROW(StatisticsException, "Cannot initialize logarithmic histogram binning with non-positive minimum!");
+	}
+	if (!(min<max))
+	{
+		THROW(StatisticsException, "Cannot initialize histogram binning with empty range!");
+	}
+
+	HistogramBinning output;
+	output.layout = LOGARITHMIC;
+	output.min = min;
+	output.max = max;
+	output.offset = std::log(min);
+	output.scale = bins_per_decade / std::log(10.0);
+	output.bins = std::max(1, static_cast<int>(std::ceil((std::log(max) - output.offset) * output.scale - 1e-9)));
+	return output;
+}
+
+HistogramBinning HistogramBinning::hdr(double min, double max, int significant_digits)
+{
+	if (significant_digits<1 || significant_digits>6)
+	{
+		THROW(StatisticsException, "Cannot initialize HDR histogram binning with " + QString::number(significant_digits) + " significant digits! Valid are 1 to 6.");
+	}
+	if (min<=0)
+	{
+		THROW(StatisticsException, "Cannot initialize HDR histogram binning with non-positive minimum!");
+	}
+	if (!(min<max))
+	{
+		THROW(StatisticsException, "Cannot initialize histogram binning with empty range!");
+	}
+
+	HistogramBinning output;
+	output.layout = HDR;
+	output.min = min;
+	output.max = max;
+	output.scale = 1.0 / min;
+	output.sub_bins = 1;
+	while (output.sub_bins < std::pow(10.0, significant_digits))
+	{
+		output.sub_bins *= 2;
+	}
+	int exponent;
+	double fraction = std::frexp(max * output.scale, &exponent);
+	output.bins = static_cast<int>(((exponent - 1) + (2.0 * fraction - 1.0)) * output.sub_bins) + 1;
+	return output;
+}
+
+double HistogramBinning::start(int index) const
+{
+	switch(layout)
+	{
+		case LINEAR:
+			return offset + index / scale;
+		case LOGARITHMIC:
+			return std::exp(offset + index / scale);
+		case HDR:
+			return std::ldexp(min * (1.0 + double(index % sub_bins) / sub_bins), index / sub_bins);
+	}
+	return std::numeric_limits<double>::quiet_NaN();
+}
+
+HistogramCounter::HistogramCounter(double min, double max, int bins)
+	: HistogramCounter(HistogramBinning::linear(min, max, bins))
+{
+}
+
+HistogramCounter::HistogramCounter(const HistogramBinning& binning)
+	: binning_(binning)
+	, counts_(binning.bins + 2, 0)
+	, invalid_(0)
+{
+}
+
+//Counts the values using the bin index function of a layout: the bin indices of a block are calculated in a branch-free loop (vectorized by the compiler), then the counts are increased
+template<HistogramBinning::Layout L>
+static void countBins(const HistogramBinning& binning, const double* data, qint64 size, quint64* counts, quint64& invalid)
+{
+	const int block_size = 1024;
+	int indices[block_size];
+	for (qint64 start=0; start<size; start+=block_size)
+	{
+		const int n = static_cast<int>(std::min(qint64(block_size), size-start));
+		const double* values = data + start;
+		for (int i=0; i<n; ++i)
+		{
+			indices[i] = binning.index<L>(values[i]) + 1;
+		}
+		for (int i=0; i<n; ++i)
+		{
+			bool valid = !std::isnan(values[i]);
+			counts[indices[i]] += valid;
+			invalid += !valid;
+		}
+	}
+}
+
+void HistogramCounter::inc(const double* data, qint64 size)
+{
+	switch(binning_.layout)
+	{
+		case HistogramBinning::LINEAR:
+			countBins<HistogramBinning::LINEAR>(binning_, data, size, counts_.data(), invalid_);
+			break;
+		case HistogramBinning::LOGARITHMIC:
+			countBins<HistogramBinning::LOGARITHMIC>(binning_, data, size, counts_.data(), invalid_);
+			break;
+		case HistogramBinning::HDR:
+			countBins<HistogramBinning::HDR>(binning_, data, size, counts_.data(), invalid_);
+			break;
+	}
+}
+
+void HistogramCounter::merge(const HistogramCounter& other)
+{
+	if (other.binning_!=binning_)
+	{
+		THROW(StatisticsException, "Cannot merge histogram counters with different bins!");
+	}
+
+	for (int i=0; i<counts_.count(); ++i)
+	{
+		counts_[i] += other.counts_[i];
+	}
+	invalid_ += other.invalid_;
+}
+
+quint64 HistogramCounter::count() const
+{
+	quint64 output = 0;
+	foreach(quint64 count, counts_)
+	{
+		output += count;
+	}
+	return output;
+}
+
 Histogram::Histogram(double min, double max, double bin_size)
 	: min_(min)
 	, max_(max)
 	, bin_size_(bin_size)
+	, out_of_range_bins_(false)
+	, underflow_(0)
+	, overflow_(0)
 	, bin_sum_(0)
 	, alpha_(std::numeric_limits<double>::quiet_NaN())
 {
@@ -36,20 +210,141 @@ Histogram::Histogram(double min, double max, double bin_size)
 	}
 
 	bins_.resize(ceil((max_-min_)/bin_size_));
+	binning_ = HistogramBinning::linear(min_, max_, bins_.size());
+}
+
+Histogram::Histogram(const HistogramBinning& binning)
+	: min_(binning.min)
+	, max_(binning.max)
+	, bin_size_(std::numeric_limits<double>::quiet_NaN())
+	, binning_(binning)
+	, out_of_range_bins_(true)
+	, underflow_(0)
+	, overflow_(0)
+	, bin_sum_(0)
+	, alpha_(std::numeric_limits<double>::quiet_NaN())
+	, bins_(binning.bins, 0.0)
+{
+}
+
+Histogram Histogram::logarithmic(double min, double max, int bins_per_decade)
+{
+	return Histogram(HistogramBinning::logarithmic(min, max, bins_per_decade));
+}
+
+Histogram Histogram::hdr(double min, double max, int significant_digits)
+{
+	return Histogram(HistogramBinning::hdr(min, max, significant_digits));
+}
+
+void Histogram::setBins(QVector<double> bin_values)
+{
+	if (binning_.layout==HistogramBinning::LINEAR)
+	{
+		if (!bin_values.isEmpty()) binning_ = HistogramBinning::linear(min_, max_, bin_values.size());
+	}
+	else if (bin_values.size()!=bins_.size())
+	{
+		THROW(StatisticsException, "Cannot change the bin count of logarithmic/HDR histograms!");
+	}
+
+	bins_ = bin_values;
 }
 
 void Histogram::inc(double val, bool ignore_bounds_errors)
 {
-	bins_[binIndex(val, ignore_bounds_errors)]+=1;
+	if (std::isnan(val)) return;
+
+	if (out_of_range_bins_)
+	{
+		int index = binning_.index(val);
+		if (index<0) ++underflow_;
+		else if (index>=bins_.size()) ++overflow_;
+		else bins_[index] += 1;
+	}
+	else
+	{
+		bins_[binIndex(val, ignore_bounds_errors)]+=1;
+	}
 	bin_sum_ += 1;
 }
 
 void Histogram::inc(const QVector<double> &data, bool ignore_bounds_errors)
 {
-	for (int i=0; i<data.size(); ++i)
+	inc(data.constData(), data.size(), ignore_bounds_errors);
+}
+
+void Histogram::inc(const double* data, qint64 size, bool ignore_bounds_errors, int threads)
+{
+	//check bounds first, so that the histogram is unchanged if an exception is thrown
+	if (!ignore_bounds_errors && !out_of_range_bins_)
+	{
+		bool out_of_range = false;
+		for (qint64 i=0; i<size; ++i)
+		{
+			out_of_range |= (data[i]<min_) | (data[i]>max_);
+		}
+		if (out_of_range)
+		{
+			for (qint64 i=0; i<size; ++i)
+			{
+				binIndex(data[i]); //throws an exception for the first value out of range
+			}
+		}
+	}
+
+	//small data or single thread > bin directly
+	const int thread_count = threads>0 ? threads : std::max(1, QThread::idealThreadCount());
+	if (size<PARALLEL_MIN_SIZE || thread_count==1)
+	{
+		HistogramCounter tmp = counter();
+		tmp.inc(data, size);
+		add(tmp);
+		return;
+	}
+
+	//bin in parallel, one counter per chunk
+	QVector<HistogramCounter> counters(thread_count, counter());
+	QVector<int> chunks;
+	for (int c=0; c<thread_count; ++c)
+	{
+		chunks << c;
+	}
+	const qint64 chunk_size = (size + thread_count - 1) / thread_count;
+	auto processChunk = [&](int c)
+	{
+		qint64 start = std::min(c * chunk_size, size);
+		qint64 end = std::min(start + chunk_size, size);
+		counters[c].inc(data + start, end - start);
+	};
+	QThreadPool pool;
+	pool.setMaxThreadCount(thread_count);
+	QtConcurrent::blockingMap(&pool, chunks, processChunk);
+
+	foreach(const HistogramCounter& tmp, counters)
+	{
+		add(tmp);
+	}
+}
+
+HistogramCounter Histogram::counter() const
+{
+	return HistogramCounter(binning_);
+}
+
+void Histogram::add(const HistogramCounter& counter)
+{
+	if (counter.binning()!=binning_ || counter.binCount()!=bins_.size())
+	{
+		THROW(StatisticsException, "Cannot add histogram counter with different bins!");
+	}
+
+	for (int i=0; i<bins_.size(); ++i)
 	{
-		inc(data[i], ignore_bounds_errors);
+		bins_[i] += counter.binValue(i);
 	}
+	addOutOfRange(counter.underflow(), counter.overflow());
+	bin_sum_ += counter.count();
 }
 
 double Histogram::maxValue(bool as_percentage) const
@@ -102,9 +397,52 @@ double Histogram::startOfBin(int index) const
 		THROW(StatisticsException, "Index " + QString::number(index) + " out of range (0-" + QString::number(bins_.size()-1) + ")!");
 	}
 
+	if (binning_.layout!=HistogramBinning::LINEAR) return binning_.start(index);
+
 	return bin_size_*index + min_;
 }
 
+double Histogram::endOfBin(int index) const
+{
+	if (binning_.layout!=HistogramBinning::LINEAR) return binning_.end(index);
+
+	return startOfBin(index) + bin_size_;
+}
+
+double Histogram::percentile(double percentage) const
+{
+	if (percentage<0.0 || percentage>100.0)
+	{
+		THROW(StatisticsException, "Invalid percentage " + QString::number(percentage) + " for percentile calculation!");
+	}
+
+	double total = underflow_ + overflow_;
+	foreach(double value, bins_)
+	{
+		total += value;
+	}
+	if (total<=0.0)
+	{
+		THROW(StatisticsException, "Cannot calculate percentile of empty histogram!");
+	}
+
+	//find the bin that contains the rank and interpolate inside the bin
+	const double rank = percentage / 100.0 * total;
+	double cumulative = underflow_;
+	if (underflow_>0 && rank<=cumulative) return min_;
+	for (int i=0; i<bins_.count(); ++i)
+	{
+		if (bins_[i]>0 && rank<=cumulative+bins_[i])
+		{
+			double start = startOfBin(i);
+			double end = std::min(endOfBin(i), max_);
+			return start + (rank - cumulative) / bins_[i] * (end - start);
+		}
+		cumulative += bins_[i];
+	}
+	return max_;
+}
+
 double Histogram::binValue(double val, bool as_percentage, bool ignore_bounds_errors) const
 {
 	double value = bins_[binIndex(val, ignore_bounds_errors)];
@@ -115,6 +453,294 @@ double Histogram::binValue(double val, bool as_percentage, bool ignore_bounds_er
 	return value;
 }
 
+void Histogram::addOutOfRange(double underflow, double overflow)
+{
+	if (out_of_range_bins_)
+	{
+		underflow_ += std::llround(underflow);
+		overflow_ += std::llround(overflow);
+	}
+	else
+	{
+		bins_.first() += underflow;
+		bins_.last() += overflow;
+	}
+}
+
+bool Histogram::isCompatible(const Histogram& other) const
+{
+	if (binning_!=other.binning_ || bins_.size()!=other.bins_.size()) return false;
+
+	//linear histograms: bin positions depend on bin size
+	return binning_.layout!=HistogramBinning::LINEAR || bin_size_==other.bin_size_;
+}
+
+void Histogram::merge(const Histogram& other, bool rebin)
+{
+	if (isCompatible(other))
+	{
+		for (int i=0; i<bins_.size(); ++i)
+		{
+			bins_[i] += other.bins_[i];
+		}
+	}
+	else if (rebin)
+	{
+		//distribute each bin value to the overlapping bins
+		double underflow = 0.0;
+		double overflow = 0.0;
+		for (int j=0; j<other.bins_.size(); ++j)
+		{
+			const double value = other.bins_[j];
+			if (value==0.0) continue;
+
+			const double start = other.startOfBin(j);
+			const double end = std::min(other.endOfBin(j), other.max());
+			const double width = end - start;
+			if (width<=0.0 || end<=min_ || start>=max_)
+			{
+				double center = width>0.0 ? 0.5 * (start + end) : start;
+				if (center<min_) underflow += value;
+				else if (center>max_) overflow += value;
+				else bins_[binIndex(center, true)] += value;
+				continue;
+			}
+
+			//parts outside the range
+			const double lower = std::max(start, min_);
+			const double upper = std::min(end, max_);
+			underflow += value * (lower - start) / width;
+			overflow += value * (end - upper) / width;
+
+			//in-range part, distributed proportionally to the overlap with the bins
+			QVector<QPair<int, double>> overlaps;
+			double overlap_sum = 0.0;
+			for (int i=binIndex(lower, true); i<bins_.size() && startOfBin(i)<upper; ++i)
+			{
+				double overlap = std::min(upper, endOfBin(i)) - std::max(lower, startOfBin(i));
+				if (overlap<=0.0) continue;
+				overlaps << qMakePair(i, overlap);
+				overlap_sum += overlap;
+			}
+			const double in_range = value * (upper - lower) / width;
+			if (overlaps.isEmpty())
+			{
+				bins_[binIndex(lower, true)] += in_range;
+				continue;
+			}
+			for (int k=0; k<overlaps.count(); ++k)
+			{
+				bins_[overlaps[k].first] += in_range * overlaps[k].second / overlap_sum;
+			}
+		}
+		addOutOfRange(underflow, overflow);
+	}
+	else
+	{
+		THROW(StatisticsException, "Cannot merge histograms with different bins!");
+	}
+
+	addOutOfRange(other.underflow_, other.overflow_);
+	bin_sum_ += other.bin_sum_;
+}
+
+//Format version of the binary serialization
+static const quint8 HISTOGRAM_BINARY_VERSION = 1;
+
+QByteArray Histogram::toBinary() const
+{
+	//integer values are stored as variable-length integers (7 bits per byte), which is compact for sparse/small counts
+	bool integral = std::all_of(bins_.cbegin(), bins_.cend(), [](double value){ return value>=0.0 && value<9007199254740992.0 && value==std::floor(value); });
+	QByteArray values;
+	if (integral)
+	{
+		foreach(double value, bins_)
+		{
+			quint64 tmp = static_cast<quint64>(value);
+			while (tmp>=128)
+			{
+				values.append(static_cast<char>(0x80 | (tmp & 0x7F)));
+				tmp >>= 7;
+			}
+			values.append(static_cast<char>(tmp));
+		}
+	}
+
+	QByteArray output;
+	QDataStream stream(&output, QIODevice::WriteOnly);
+	stream.setVersion(QDataStream::Qt_6_0);
+	stream.writeRawData("HIST", 4);
+	stream << HISTOGRAM_BINARY_VERSION << static_cast<qint8>(binning_.layout) << binning_.min << binning_.max << static_cast<qint32>(binning_.bins) << binning_.offset << binning_.scale << static_cast<qint32>(binning_.sub_bins);
+	stream << bin_size_ << out_of_range_bins_ << static_cast<qint64>(underflow_) << static_cast<qint64>(overflow_) << static_cast<qint64>(bin_sum_) << integral;
+	if (integral)
+	{
+		stream << values;
+	}
+	else
+	{
+		foreach(double value, bins_)
+		{
+			stream << value;
+		}
+	}
+
+	return output;
+}
+
+Histogram Histogram::fromBinary(const QByteArray& data)
+{
+	QDataStream stream(data);
+	stream.setVersion(QDataStream::Qt_6_0);
+
+	char magic[4];
+	quint8 version = 0;
+	if (stream.readRawData(magic, 4)!=4 || QByteArray(magic, 4)!="HIST")
+	{
+		THROW(FileParseException, "Invalid binary histogram data: header not found!");
+	}
+	stream >> version;
+	if (version!=HISTOGRAM_BINARY_VERSION)
+	{
+		THROW(FileParseException, "Unsupported binary histogram version " + QString::number(version) + "!");
+	}
+
+	HistogramBinning binning;
+	qint8 layout;
+	qint32 bins;
+	qint32 sub_bins;
+	double bin_size;
+	bool out_of_range_bins;
+	qint64 underflow;
+	qint64 overflow;
+	qint64 bin_sum;
+	bool integral;
+	stream >> layout >> binning.min >> binning.max >> bins >> binning.offset >> binning.scale >> sub_bins;
+	stream >> bin_size >> out_of_range_bins >> underflow >> overflow >> bin_sum >> integral;
+	if (stream.status()!=QDataStream::Ok || layout<HistogramBinning::LINEAR || layout>HistogramBinning::HDR || bins<=0 || (layout==HistogramBinning::HDR && sub_bins<=0))
+	{
+		THROW(FileParseException, "Invalid binary histogram data: truncated or invalid header!");
+	}
+	binning.layout = static_cast<HistogramBinning::Layout>(layout);
+	binning.bins = bins;
+	binning.sub_bins = sub_bins;
+
+	QVector<double> values(bins, 0.0);
+	if (integral)
+	{
+		QByteArray encoded;
+		stream >> encoded;
+		int pos = 0;
+		for (int i=0; i<bins; ++i)
+		{
+			quint64 value = 0;
+			int shift = 0;
+			while (true)
+			{
+				if (pos>=encoded.size() || shift>63) THROW(FileParseException, "Invalid binary histogram data: truncated bin values!");
+				quint8 byte = static_cast<quint8>(encoded[pos++]);
+				value |= quint64(byte & 0x7F) << shift;
+				if ((byte & 0x80)==0) break;
+				shift += 7;
+			}
+			values[i] = value;
+		}
+	}
+	else
+	{
+		for (int i=0; i<bins; ++i)
+		{
+			stream >> values[i];
+		}
+	}
+	if (stream.status()!=QDataStream::Ok)
+	{
+		THROW(FileParseException, "Invalid binary histogram data: truncated bin values!");
+	}
+
+	Histogram output(binning);
+	output.bin_size_ = bin_size;
+	output.out_of_range_bins_ = out_of_range_bins;
+	output.underflow_ = underflow;
+	output.overflow_ = overflow;
+	output.bin_sum_ = bin_sum;
+	output.bins_ = values;
+	return output;
+}
+
+void Histogram::storeTsv(QString filename) const
+{
+	auto number = [](double value){ return QString::number(value, 'g', 17); };
+
+	QStringList lines;
+	lines << "##layout=" + QString::number(binning_.layout);
+	lines << "##min=" + number(binning_.min);
+	lines << "##max=" + number(binning_.max);
+	lines << "##bins=" + QString::number(binning_.bins);
+	lines << "##offset=" + number(binning_.offset);
+	lines << "##scale=" + number(binning_.scale);
+	lines << "##sub_bins=" + QString::number(binning_.sub_bins);
+	lines << "##bin_size=" + number(bin_size_);
+	lines << "##out_of_range_bins=" + QString::number(out_of_range_bins_);
+	lines << "##underflow=" + QString::number(underflow_);
+	lines << "##overflow=" + QString::number(overflow_);
+	lines << "##bin_sum=" + QString::number(bin_sum_);
+	lines << "#start\tend\tvalue";
+	for (int i=0; i<bins_.size(); ++i)
+	{
+		lines << number(startOfBin(i)) + "\t" + number(endOfBin(i)) + "\t" + number(bins_[i]);
+	}
+
+	Helper::storeTextFile(filename, lines);
+}
+
+Histogram Histogram::loadTsv(QString filename)
+{
+	QMap<QString, QString> header;
+	QVector<double> values;
+	foreach(const QString& line, Helper::loadTextFile(filename, true, QChar::Null, true))
+	{
+		if (line.startsWith("##"))
+		{
+			int sep = line.indexOf('=');
+			if (sep==-1) THROW(FileParseException, "Invalid histogram header line in '" + filename + "': " + line);
+			header[line.mid(2, sep-2)] = line.mid(sep+1);
+		}
+		else if (!line.startsWith("#"))
+		{
+			QStringList parts = line.split('\t');
+			if (parts.count()!=3) THROW(FileParseException, "Invalid histogram bin line in '" + filename + "': " + line);
+			values << Helper::toDouble(parts[2], "histogram bin value", line);
+		}
+	}
+	foreach(QString key, QStringList() << "layout" << "min" << "max" << "bins" << "offset" << "scale" << "sub_bins" << "bin_size" << "out_of_range_bins" << "underflow" << "overflow" << "bin_sum")
+	{
+		if (!header.contains(key)) THROW(FileParseException, "Histogram header line '" + key + "' missing in '" + filename + "'!");
+	}
+
+	HistogramBinning binning;
+	int layout = Helper::toInt(header["layout"], "histogram layout");
+	if (layout<HistogramBinning::LINEAR || layout>HistogramBinning::HDR) THROW(FileParseException, "Invalid histogram layout '" + header["layout"] + "' in '" + filename + "'!");
+	binning.layout = static_cast<HistogramBinning::Layout>(layout);
+	binning.min = Helper::toDouble(header["min"], "histogram minimum");
+	binning.max = Helper::toDouble(header["max"], "histogram maximum");
+	binning.bins = Helper::toInt(header["bins"], "histogram bin count");
+	if (binning.bins<=0) THROW(FileParseException, "Invalid histogram bin count '" + header["bins"] + "' in '" + filename + "'!");
+	binning.offset = Helper::toDouble(header["offset"], "histogram offset");
+	binning.scale = Helper::toDouble(header["scale"], "histogram scale");
+	binning.sub_bins = Helper::toInt(header["sub_bins"], "histogram sub-bins");
+	if (binning.layout==HistogramBinning::HDR && binning.sub_bins<=0) THROW(FileParseException, "Invalid histogram sub-bins '" + header["sub_bins"] + "' of HDR histogram in '" + filename + "'!");
+	if (binning.bins!=values.count()) THROW(FileParseException, "Histogram bin count " + QString::number(binning.bins) + " does not match the number of bin lines " + QString::number(values.count()) + " in '" + filename + "'!");
+
+	Histogram output(binning);
+	output.bin_size_ = header["bin_size"]=="nan" ? std::numeric_limits<double>::quiet_NaN() : Helper::toDouble(header["bin_size"], "histogram bin size");
+	output.out_of_range_bins_ = Helper::toInt(header["out_of_range_bins"], "histogram out-of-range bins flag")!=0;
+	output.underflow_ = header["underflow"].toLongLong();
+	output.overflow_ = header["overflow"].toLongLong();
+	output.bin_sum_ = header["bin_sum"].toLongLong();
+	output.bins_ = values;
+	return output;
+}
+
 int Histogram::binIndex(double val, bool ignore_bounds_errors) const
 {
 	if (!ignore_bounds_errors && (val < min_ || val > max_))
@@ -122,7 +748,7 @@ int Histogram::binIndex(double val, bool ignore_bounds_errors) const
 		THROW(StatisticsException, "Requested position '" + QString::number(val) + "' not in range (" + QString::number(min_) + "-" + QString::number(max_) + ")!");
 	}
 
-	int index = floor ( (val-min_) / (max_-min_) * bins_.size());
+	int index = binning_.index(val);
 	return BasicStatistics::bound(static_cast<qsizetype>(index), static_cast<qsizetype>(0), static_cast<qsizetype>(bins_.size()-1));
 }
 
@@ -132,7 +758,7 @@ void Histogram::print(QTextStream& stream, QString indentation, int position_pre
 	{
 		int index = ascending ? i : bins_.count()-i-1;
 		double start = startOfBin(index);
-		double end = start + bin_size_;
+		double end = endOfBin(index);
 		if (!ascending) std::swap(start, end);
 		stream << indentation << QString::number(start, 'f', position_precision) << "-" << QString::number(end, 'f', position_precision) << ": " << QString::number(binValue(index), 'f', data_precision) << "\n";
 	}
@@ -140,7 +766,19 @@ void Histogram::print(QTextStream& stream, QString indentation, int position_pre
 
 QVector<double> Histogram::xCoords()
 {
-	return BasicStatistics::range(binCount(), startOfBin(0) + 0.5 * binSize(), binSize());
+	if (binning_.layout==HistogramBinning::LINEAR)
+	{
+		return BasicStatistics::range(binCount(), startOfBin(0) + 0.5 * binSize(), binSize());
+	}
+
+	//bin centers
+	QVector<double> output;
+	output.reserve(binCount());
+	for (int i=0; i<binCount(); ++i)
+	{
+		output << 0.5 * (startOfBin(i) + endOfBin(i));
+	}
+	return output;
 }
 
 QVector<double> Histogram::yCoords(bool as_percentage)
@@ -239,14 +877,17 @@ void Histogram::store(QString filename, bool x_log_scale, bool y_log_scale, doub
 	QLineSeries *lower = new QLineSeries();
 	double baseline = y_log_scale ? min_offset : 0.0;
 
-	// centering each bin
-	lower->append(x.first()-(binSize()/2), baseline);
-	upper->append(x.first()-(binSize()/2), baseline);
+	// centering each bin (logarithmic/HDR bins are drawn at their bounds)
+	bool linear = binning_.layout==HistogramBinning::LINEAR;
+	auto binStart = [&](int i) { return linear ? x[i]-(binSize()/2) : startOfBin(i); };
+	auto binEnd = [&](int i) { return linear ? x[i]-(binSize()/2)+binSize() : endOfBin(i); };
+	lower->append(binStart(0), baseline);
+	upper->append(binStart(0), baseline);
 
 	for (int i = 0; i < y.size(); ++i)
 	{
-		upper->append(x[i]-(binSize()/2), y[i]);
-		double next_item = x[i]-(binSize()/2)+binSize();
+		upper->append(binStart(i), y[i]);
+		double next_item = binEnd(i);
 		upper->append(next_item, y[i]);
 		lower->append(next_item, baseline);
 	}
@@ -286,6 +927,106 @@ void Histogram::store(QString filename, bool x_log_scale, bool y_log_scale, doub
 	plot_utils->saveAsPng(filename, 1000, 400);
 }
 
+PlotRenderer Histogram::renderer(bool x_log_scale, bool y_log_scale, double min_offset)
+{
+	QVector<double> x = xCoords();
+	QVector<double> y = yCoords();
+
+	// Fixing zero values for logarithmic scaling (for X and Y separately)
+	for(int i = 0; i < x.size(); ++i)
+	{
+		if(x_log_scale && x[i] <= 0.0) x[i] = min_offset;
+		double shifted = x[i] - (binSize() / 2);
+		if (shifted <= 0.0) x[i] = min_offset + (binSize() / 2);
+	}
+	for(int i = 0; i < y.size(); ++i)
+	{
+		if(y_log_scale && y[i] <= 0.0) y[i] = min_offset;
+	}
+	double x_min = min();
+	double y_min = minValue();
+	if(x_log_scale && x_min == 0.0) x_min += min_offset;
+	if(y_log_scale && y_min == 0.0) y_min += min_offset;
+
+	PlotRenderer output(1000, 400);
+	output.setXLabel(xlabel_);
+	output.setYLabel(ylabel_);
+	output.setXLogScale(x_log_scale);
+	output.setYLogScale(y_log_scale);
+	output.setXRange(x_min, max());
+	output.setYRange(y_min, maxValue() + 0.2 * maxValue());
+	output.setLegendVisible(false);
+
+	// centering each bin (logarithmic/HDR bins are drawn at their bounds)
+	bool linear = binning_.layout==HistogramBinning::LINEAR;
+	auto binStart = [&](int i) { return linear ? x[i]-(binSize()/2) : startOfBin(i); };
+	auto binEnd = [&](int i) { return linear ? x[i]-(binSize()/2)+binSize() : endOfBin(i); };
+	double baseline = y_log_scale ? min_offset : 0.0;
+	QVector<QPointF> outline;
+	if (!y.isEmpty())
+	{
+		outline << QPointF(binStart(0), baseline);
+		for (int i = 0; i < y.size(); ++i)
+		{
+			outline << QPointF(binStart(i), y[i]) << QPointF(binEnd(i), y[i]);
+		}
+		outline << QPointF(binEnd(y.size()-1), baseline);
+	}
+
+	QColor bar_color(Qt::blue);
+	bar_color.setAlphaF(0.8);
+	output.addArea(outline, bar_color, bar_color.darker(), label_);
+
+	return output;
+}
+
+PlotRenderer Histogram::combinedRenderer(QList<Histogram> histograms, QString xlabel, QString ylabel)
+{
+	double min = 0;
+	double max = 0;
+	double min_value = 0;
+	double max_value = 0;
+	foreach(Histogram h, histograms)
+	{
+		if(min > h.min()) min = h.min();
+		if(max < h.max()) max = h.max();
+		if(min_value > h.minValue()) min_value = h.minValue();
+		if(max_value < h.maxValue()) max_value = h.maxValue();
+	}
+
+	PlotRenderer output(1000, 400);
+	output.setXLabel(xlabel);
+	output.setYLabel(ylabel);
+	output.setXRange(min, max);
+	output.setYRange(min_value, max_value);
+
+	int n = histograms.size();
+	for (int i = 0; i < n; ++i)
+	{
+		Histogram& h = histograms[i];
+		QColor bar_color = h.color_.isEmpty() ? QColor::fromHsv(i * 360 / n, 200, 230) : QColor(h.color_); // evenly spaced hues
+		bar_color.setAlphaF(0.8);
+
+		QVector<double> x = h.xCoords();
+		QVector<double> y = h.yCoords();
+		bool linear = h.binning().layout==HistogramBinning::LINEAR;
+		auto binStart = [&](int bin) { return linear ? x[bin]-(h.binSize()/2) : h.startOfBin(bin); };
+		auto binEnd = [&](int bin) { return linear ? x[bin]-(h.binSize()/2)+h.binSize() : h.endOfBin(bin); };
+		if (y.isEmpty()) continue;
+		QVector<QPointF> outline;
+		outline << QPointF(binStart(0), 0);
+		for (int j = 0; j < y.size(); ++j)
+		{
+			outline << QPointF(binStart(j), y[j]) << QPointF(binEnd(j), y[j]);
+		}
+		outline << QPointF(binEnd(y.size()-1), 0);
+
+		output.addArea(outline, bar_color, bar_color.darker(), h.label_);
+	}
+
+	return output;
+}
+
 void Histogram::storeCombinedHistogram(QString filename, QList<Histogram> histograms, QString xlabel, QString ylabel)
 {
 	if (histograms.isEmpty())
@@ -345,14 +1086,17 @@ void Histogram::storeCombinedHistogram(QString filename, QList<Histogram> histog
 		QVector<double> x = h.xCoords();
 		QVector<double> y = h.yCoords();
 
-		// centering each bin
-		lower->append(x.first()-(h.binSize()/2), 0);
-		upper->append(x.first()-(h.binSize()/2), 0);
+		// centering each bin (logarithmic/HDR bins are drawn at their bounds)
+		bool linear = h.binning().layout==HistogramBinning::LINEAR;
+		auto binStart = [&](int i) { return linear ? x[i]-(h.binSize()/2) : h.startOfBin(i); };
+		auto binEnd = [&](int i) { return linear ? x[i]-(h.binSize()/2)+h.binSize() : h.endOfBin(i); };
+		lower->append(binStart(0), 0);
+		upper->append(binStart(0), 0);
 
 		for (int i = 0; i < y.size(); ++i)
 		{
-			upper->append(x[i]-(h.binSize()/2), y[i]);
-			double next_item = x[i]-(h.binSize()/2)+h.binSize();
+			upper->append(binStart(i), y[i]);
+			double next_item = binEnd(i);
 			upper->append(next_item, y[i]);
 			lower->append(next_item, 0);
 		}
@@ -3,7 +3,166 @@
 
 #include "cppCORE_global.h"
 #include <QVector>
+#include <QByteArray>
 #include <QTextStream>
+#include <cmath>
+#include "PlotRenderer.h"
+
+///Mapping of values to the bins of a Histogram.
+struct CPPCORESHARED_EXPORT HistogramBinning
+{
+	///Bin layout.
+	enum Layout
+	{
+		LINEAR, ///< Bins of equal width.
+		LOGARITHMIC, ///< Bins of equal width on a logarithmic scale, i.e. with constant relative width.
+		HDR ///< High dynamic range: each power of two (relative to the minimum) is divided into 'sub_bins' bins of equal width.
+	};
+
+	///Bin layout.
+	Layout layout = LINEAR;
+	///Lower bound of the first bin.
+	double min = 0.0;
+	///Upper bound. Larger values are out of range, even if the last bin extends beyond it.
+	double max = 0.0;
+	///Number of bins.
+	int bins = 0;
+	///Offset of the bin positions: minimum (LINEAR), log of the minimum (LOGARITHMIC), unused (HDR).
+	double offset = 0.0;
+	///Scale of the bin positions: reciprocal bin width (LINEAR), reciprocal bin width on log scale (LOGARITHMIC), reciprocal minimum (HDR).
+	double scale = 0.0;
+	///Bins per power of two (HDR layout).
+	int sub_bins = 0;
+
+	///Creates a linear binning with @p bins bins in the range [min, max].
+	static HistogramBinning linear(double min, double max, int bins);
+	///Creates a logarithmic binning with @p bins_per_decade bins per power of ten in the range [min, max]. The minimum must be positive.
+	static HistogramBinning logarithmic(double min, double max, int bins_per_decade);
+	///Creates an HDR binning in the range [min, max]. The relative bin width is at most 10^-significant_digits. The minimum must be positive.
+	static HistogramBinning hdr(double min, double max, int significant_digits);
+
+	///Returns the bin index of a value: -1 for values below the range (and NaN), 'bins' for values above the range.
+	template<Layout L>
+	int index(double value) const
+	{
+		double x;
+		if constexpr (L==LINEAR)
+		{
+			x = (value - offset) * scale;
+		}
+		else if constexpr (L==LOGARITHMIC)
+		{
+			x = (std::log(value) - offset) * scale;
+		}
+		else
+		{
+			int exponent;
+			double fraction = std::frexp(value * scale, &exponent);
+			x = ((exponent - 1) + (2.0 * fraction - 1.0)) * sub_bins;
+		}
+		//branch-free range handling (compiled to selects)
+		const double last = bins - 1;
+		x = x>0.0 ? x : 0.0;
+		x = x<last ? x : last;
+		x = value<=max ? x : double(bins);
+		x = value>=min ? x : -1.0; //last, so NaN (both comparisons false) maps to -1
+		return static_cast<int>(x);
+	}
+	///Returns the bin index of a value: -1 for values below the range (and NaN), 'bins' for values above the range.
+	int index(double value) const
+	{
+		switch(layout)
+		{
+			case LINEAR: return index<LINEAR>(value);
+			case LOGARITHMIC: return index<LOGARITHMIC>(value);
+			case HDR: return index<HDR>(value);
+		}
+		return -1;
+	}
+	///Returns the lower bound of a bin.
+	double start(int index) const;
+	///Returns the upper bound of a bin.
+	double end(int index) const
+	{
+		return start(index + 1);
+	}
+
+	///Returns if two binnings are identical.
+	bool operator==(const HistogramBinning& rhs) const
+	{
+		return layout==rhs.layout && min==rhs.min && max==rhs.max && bins==rhs.bins && offset==rhs.offset && scale==rhs.scale && sub_bins==rhs.sub_bins;
+	}
+	///Returns if two binnings differ.
+	bool operator!=(const HistogramBinning& rhs) const
+	{
+		return !(*this==rhs);
+	}
+};
+
+///Integer bin counts for high-throughput filling of a Histogram (see Histogram::counter()).
+///Each thread fills its own counter and the counters are merged at the end. Values outside the range are counted separately (underflow/overflow), NaN values are not counted.
+class CPPCORESHARED_EXPORT HistogramCounter
+{
+public:
+	///Constructor for @p bins bins of equal width in the range [min, max].
+	HistogramCounter(double min, double max, int bins);
+	///Constructor for an arbitrary binning.
+	HistogramCounter(const HistogramBinning& binning);
+
+	///Increases the bin of the value by one.
+	void inc(double value)
+	{
+		if (std::isnan(value))
+		{
+			++invalid_;
+			return;
+		}
+		++counts_[binning_.index(value) + 1];
+	}
+	///Increases the bins of the values by one. The bin indices are calculated in blocks by a vectorized loop.
+	void inc(const double* data, qint64 size);
+	///Adds the counts of another counter with the same binning.
+	void merge(const HistogramCounter& other);
+
+	///Returns the binning.
+	const HistogramBinning& binning() const
+	{
+		return binning_;
+	}
+	///Returns the number of bins.
+	int binCount() const
+	{
+		return binning_.bins;
+	}
+	///Returns the count of a bin.
+	quint64 binValue(int index) const
+	{
+		return counts_[index + 1];
+	}
+	///Returns the number of values below the range.
+	quint64 underflow() const
+	{
+		return counts_.first();
+	}
+	///Returns the number of values above the range.
+	quint64 overflow() const
+	{
+		return counts_.last();
+	}
+	///Returns the number of counted values, including underflow and overflow.
+	quint64 count() const;
+	///Returns the number of NaN values, which were not counted.
+	quint64 invalidCount() const
+	{
+		return invalid_;
+	}
+
+protected:
+	HistogramBinning binning_;
+	//counts with underflow at index 0 and overflow at the last index
+	QVector<quint64> counts_;
+	quint64 invalid_;
+};
 
 
 ///Histogram representation
@@ -13,12 +172,50 @@ public:
 	/// Default constructor
 	Histogram(double min, double max, double bin_size);
 
-	/// Increases the bin corresponding to value @p val by one
+	/// Creates a histogram with logarithmic bins (@p bins_per_decade bins per power of ten). Out-of-range bins are enabled.
+	static Histogram logarithmic(double min, double max, int bins_per_decade);
+
+	/// Creates a histogram with HDR bins, i.e. constant relative precision (bin width at most 10^-significant_digits of the value) over many orders of magnitude with constant memory. Out-of-range bins are enabled.
+	static Histogram hdr(double min, double max, int significant_digits=2);
+
+	/// Increases the bin corresponding to value @p val by one. NaN values are ignored.
 	void inc(double val, bool ignore_bounds_errors=false);
 
 	/// Increases the bin corresponding to the values in @p data by one
 	void inc(const QVector<double>& data, bool ignore_bounds_errors=false);
 
+	/// Increases the bin corresponding to the values in @p data by one. NaN values are ignored.
+	/// Large arrays are binned in parallel into per-thread HistogramCounter objects, which are added at the end. If @p threads is 0, the ideal thread count is used.
+	void inc(const double* data, qint64 size, bool ignore_bounds_errors=false, int threads=1);
+
+	/// Returns an empty counter with the same bins, e.g. for filling from several threads.
+	HistogramCounter counter() const;
+
+	/// Adds the counts of a counter created by counter().
+	void add(const HistogramCounter& counter);
+
+	/// Returns if the bins of the histograms are identical, i.e. if they can be merged without rebinning.
+	bool isCompatible(const Histogram& other) const;
+
+	/// Merges another histogram into this one. If the bins are not compatible and @p rebin is true, the value of each bin of @p other is distributed to the overlapping bins proportionally to the overlap (assuming uniformly distributed values inside the bin).
+	/// Parts outside the range are counted in the underflow/overflow bins (rounded) or the first/last bin, depending on outOfRangeBins(). If the bins are not compatible and @p rebin is false, an exception is thrown.
+	void merge(const Histogram& other, bool rebin=false);
+
+	/// Serializes the bins, out-of-range counts and bin sum in a compact binary format (integer bin values are stored as variable-length integers). Labels and colors are not stored.
+	QByteArray toBinary() const;
+
+	/// Deserializes a histogram created by toBinary().
+	static Histogram fromBinary(const QByteArray& data);
+
+	/// Stores the bins, out-of-range counts and bin sum as TSV file (binning in header lines, one line per bin with start, end and value).
+	void storeTsv(QString filename) const;
+
+	/// Loads a histogram stored by storeTsv().
+	static Histogram loadTsv(QString filename);
+
+	/// Minimum array size for parallel binning.
+	static constexpr qint64 PARALLEL_MIN_SIZE = 1048576;
+
 	/// Returns the lower bound position (x-axis)
 	double min() const
 	{
@@ -31,18 +228,48 @@ public:
 		return max_;
 	}
 
-	/// Returns the bin size
+	/// Returns the bin size (NaN for logarithmic and HDR histograms)
 	double binSize() const
 	{
 		return bin_size_;
 	}
 
-	/// Sets bins (y coordinates)
-	void setBins(QVector<double> bin_values)
+	/// Returns the binning
+	const HistogramBinning& binning() const
 	{
-		bins_ = bin_values;
+		return binning_;
 	}
 
+	/// Enables/disables out-of-range bins. If enabled, values outside the range are counted in the underflow/overflow bins, instead of throwing an exception or being counted in the first/last bin (ignore_bounds_errors).
+	void setOutOfRangeBins(bool enabled)
+	{
+		out_of_range_bins_ = enabled;
+	}
+
+	/// Returns if out-of-range bins are enabled
+	bool outOfRangeBins() const
+	{
+		return out_of_range_bins_;
+	}
+
+	/// Returns the number of values below the range (only counted if out-of-range bins are enabled)
+	long long underflow() const
+	{
+		return underflow_;
+	}
+
+	/// Returns the number of values above the range (only counted if out-of-range bins are enabled)
+	long long overflow() const
+	{
+		return overflow_;
+	}
+
+	/// Returns the value below which the given percentage (0-100) of the data points lies, interpolated linearly inside the bin. Underflow/overflow values are counted at the lower/upper bound.
+	double percentile(double percentage) const;
+
+	/// Sets bins (y coordinates)
+	void setBins(QVector<double> bin_values);
+
 	/// Returns the number of bins
 	int binCount() const
 	{
@@ -79,6 +306,9 @@ public:
 	/// Returns the start position of the bin with the index @p index
 	double startOfBin(int index) const;
 
+	/// Returns the end position of the bin with the index @p index
+	double endOfBin(int index) const;
+
 	/// Prints the histogram to a stream
 	void print(QTextStream &stream, QString indentation="", int position_precision=2, int data_precision=2, bool ascending=true) const;
 
@@ -94,6 +324,12 @@ public:
 	/// stores a combined histogram of different histograms
 	static void storeCombinedHistogram(QString filename, QList<Histogram> histograms, QString xlabel, QString ylabel);
 
+	/// Returns a renderer for the histogram plot (see store), which draws it without QtCharts (see PlotRenderer)
+	PlotRenderer renderer(bool x_log_scale=false, bool y_log_scale=false, double min_offset=1e-6);
+
+	/// Returns a renderer for a combined histogram of different histograms (see storeCombinedHistogram)
+	static PlotRenderer combinedRenderer(QList<Histogram> histograms, QString xlabel, QString ylabel);
+
 	void setYLabel(QString ylabel)
 	{
 		ylabel_ = ylabel;
@@ -116,6 +352,9 @@ public:
 	}
 
 protected:
+	/// Constructor for an arbitrary binning
+	Histogram(const HistogramBinning& binning);
+
 	/// lower bound position
 	double min_;
 
@@ -125,6 +364,21 @@ protected:
 	/// bin size
 	double bin_size_;
 
+	/// mapping of values to bins
+	HistogramBinning binning_;
+
+	/// out-of-range bins enabled
+	bool out_of_range_bins_;
+
+	/// values below the range
+	long long underflow_;
+
+	/// values above the range
+	long long overflow_;
+
+	/// adds values below/above the range (to the underflow/overflow bins or the first/last bin)
+	void addOutOfRange(double underflow, double overflow);
+
 	/// sum of all bins (used for percentage mode)
 	long long bin_sum_;
 
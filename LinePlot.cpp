@@ -1,6 +1,7 @@
 #include "LinePlot.h"
 
 #include <limits>
+#include <cmath>
 #include <QChartView>
 #include <QLineSeries>
 #include <QValueAxis>
@@ -13,6 +14,7 @@
 
 LinePlot::LinePlot()
 	: yrange_set_(false)
+	, decimation_buckets_(DECIMATION_BUCKETS)
 {
 }
 
@@ -36,14 +38,8 @@ void LinePlot::setXValues(const QVector<double>& xvalues)
 	xvalues_ = xvalues;
 }
 
-void LinePlot::store(QString filename)
+void LinePlot::determineRange()
 {
-	if (lines_.isEmpty())
-	{
-		Log::warn("LinePlot does not have any lines to plot");
-		return;
-	}
-
 	if (!yrange_set_)
 	{
 		double minVal = std::numeric_limits<double>::max();
@@ -64,6 +60,44 @@ void LinePlot::store(QString filename)
 			ymax_ = maxVal + 0.01 * (maxVal - minVal);
 		}
 	}
+}
+
+PlotRenderer LinePlot::renderer()
+{
+	determineRange();
+
+	PlotRenderer output(600, 400);
+	output.setXLabel(xlabel_);
+	output.setYLabel(ylabel_);
+	if (BasicStatistics::isValidFloat(ymin_) && BasicStatistics::isValidFloat(ymax_))
+	{
+		output.setYRange(ymin_, ymax_);
+	}
+
+	for (const PlotLine& line : lines_)
+	{
+		output.addLine(decimate(xvalues_, line.values, decimation_buckets_), QColor(), line.label, 1.5);
+	}
+
+	// title and legend
+	if (lines_.count() == 1)
+	{
+		output.setTitle(lines_[0].label);
+		output.setLegendVisible(false);
+	}
+
+	return output;
+}
+
+void LinePlot::store(QString filename)
+{
+	if (lines_.isEmpty())
+	{
+		Log::warn("LinePlot does not have any lines to plot");
+		return;
+	}
+
+	determineRange();
 
 	PlotUtils* plot_utils = new PlotUtils();
 	QChart* chart = plot_utils->getChart();
@@ -89,12 +123,7 @@ void LinePlot::store(QString filename)
 		QLineSeries* series = new QLineSeries();
 		series->setName(line.label);
 
-		int n = line.values.size();
-		for (int i = 0; i < n; ++i)
-		{
-			double x = (i < xvalues_.size()) ? xvalues_[i] : i;
-			series->append(x, line.values[i]);
-		}
+		series->append(decimate(xvalues_, line.values, decimation_buckets_));
 
 		chart->addSeries(series);
 		series->attachAxis(axis_x);
@@ -131,6 +160,64 @@ void LinePlot::store(QString filename)
 	plot_utils->saveAsPng(filename, 600, 400);
 }
 
+QVector<QPointF> LinePlot::decimate(const QVector<double>& x, const QVector<double>& y, int buckets)
+{
+	const int n = y.count();
+	auto xValue = [&](int i)
+	{
+		return (i < x.size()) ? x[i] : i;
+	};
+
+	QVector<QPointF> output;
+	output.reserve(n);
+
+	// decimation only preserves the rendering for sorted x values and finite y values
+	bool decimate = buckets > 0 && n > 4 * buckets;
+	for (int i = 0; decimate && i < n; ++i)
+	{
+		if (!std::isfinite(y[i]) || !std::isfinite(xValue(i)) || (i > 0 && xValue(i) < xValue(i-1))) decimate = false;
+	}
+	if (!decimate)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			output.append(QPointF(xValue(i), y[i]));
+		}
+		return output;
+	}
+
+	// first, minimum, maximum and last point of each bucket, in x order
+	const double xmin = xValue(0);
+	const double xmax = xValue(n-1);
+	const double scale = xmax > xmin ? buckets / (xmax - xmin) : 0.0;
+	int start = 0;
+	while (start < n)
+	{
+		const int bucket = std::min(buckets - 1, static_cast<int>((xValue(start) - xmin) * scale));
+		int end = start + 1;
+		int min = start;
+		int max = start;
+		while (end < n && std::min(buckets - 1, static_cast<int>((xValue(end) - xmin) * scale)) == bucket)
+		{
+			if (y[end] < y[min]) min = end;
+			if (y[end] > y[max]) max = end;
+			++end;
+		}
+
+		int indices[4] = {start, std::min(min, max), std::max(min, max), end - 1};
+		for (int j = 0; j < 4; ++j)
+		{
+			if (j > 0 && indices[j] == indices[j-1]) continue;
+			output.append(QPointF(xValue(indices[j]), y[indices[j]]));
+		}
+
+		start = end;
+	}
+
+	output.squeeze();
+	return output;
+}
+
 
 LinePlot::PlotLine::PlotLine()
 {
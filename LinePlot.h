@@ -4,11 +4,16 @@
 #include "cppCORE_global.h"
 #include <QString>
 #include <QVector>
+#include <QPointF>
+#include "PlotRenderer.h"
 
 // Creates a line plot PNG image
 class CPPCORESHARED_EXPORT LinePlot
 {
 public:
+	//default number of x-axis buckets used for decimation (two per pixel of the 600px output)
+	static constexpr int DECIMATION_BUCKETS = 1200;
+
 	LinePlot();
 
 	void addLine(const QVector<double>& values, QString label = "");
@@ -31,7 +36,19 @@ public:
 		yrange_set_ = true;
 	}
 
+	//sets the number of x-axis buckets used to decimate lines before plotting. 0 disables decimation.
+	void setDecimation(int buckets)
+	{
+		decimation_buckets_ = buckets;
+	}
+
 	void store(QString filename);
+	//returns a renderer for the plot, which draws it without QtCharts (see PlotRenderer)
+	PlotRenderer renderer();
+
+	//Reduces a line to the first, minimum, maximum and last point of each x-axis bucket (M4 decimation), which renders (nearly) identical to the full line.
+	//If @p x is empty, the value index is used as x. Lines with unsorted x values, non-finite values or less than 4 points per bucket are returned unchanged.
+	static QVector<QPointF> decimate(const QVector<double>& x, const QVector<double>& y, int buckets);
 
 protected:
 	// line representation
@@ -53,6 +70,10 @@ protected:
 
 	//variables to store the meta data
 	bool yrange_set_;
+	int decimation_buckets_;
+
+	//determines the y range from the values, if not set
+	void determineRange();
 };
 
 #endif // LINEPLOT_H
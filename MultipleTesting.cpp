@@ -0,0 +1,224 @@
+#include "MultipleTesting.h"
+#include "Exceptions.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+
+//Calls the function for all items on a thread pool. If @p threads is 0, the global thread pool is used.
+template<typename TFunction>
+static void blockingMap(QVector<int>& items, int threads, TFunction function)
+{
+	if (threads<=0)
+	{
+		QtConcurrent::blockingMap(items, function);
+	}
+	else
+	{
+		QThreadPool pool;
+		pool.setMaxThreadCount(threads);
+		QtConcurrent::blockingMap(&pool, items, function);
+	}
+}
+
+//Sorts the data: chunks are sorted in parallel and merged in parallel rounds of pairwise merges.
+template<typename T>
+static void parallelSort(QVector<T>& data, int threads)
+{
+	const int thread_count = threads>0 ? threads : std::max(1, QThread::idealThreadCount());
+	if (data.count()<MultipleTesting::PARALLEL_SORT_MIN_SIZE || thread_count==1)
+	{
+		std::sort(data.begin(), data.end());
+		return;
+	}
+
+	//sort chunks
+	const int chunk_count = thread_count;
+	const qint64 chunk_size = (data.count() + chunk_count - 1) / chunk_count;
+	QVector<qint64> bounds;
+	for (int c=0; c<=chunk_count; ++c)
+	{
+		bounds << std::min(c * chunk_size, qint64(data.count()));
+	}
+	QVector<int> chunks;
+	for (int c=0; c<chunk_count; ++c)
+	{
+		chunks << c;
+	}
+	T* values = data.data();
+	blockingMap(chunks, threads, [&](int c)
+	{
+		std::sort(values + bounds[c], values + bounds[c+1]);
+	});
+
+	//merge neighboring runs into the buffer until one run is left
+	QVector<T> buffer(data.count());
+	T* source = values;
+	T* target = buffer.data();
+	for (int width=1; width<chunk_count; width*=2)
+	{
+		QVector<int> merges;
+		for (int c=0; c<chunk_count; c+=2*width)
+		{
+			merges << c;
+		}
+		blockingMap(merges, threads, [&](int c)
+		{
+			qint64 start = bounds[c];
+			qint64 middle = bounds[std::min(c + width, chunk_count)];
+			qint64 end = bounds[std::min(c + 2*width, chunk_count)];
+			std::merge(source + start, source + middle, source + middle, source + end, target + start);
+		});
+		std::swap(source, target);
+	}
+	if (source!=values)
+	{
+		std::copy(source, source + data.count(), values);
+	}
+}
+
+MultipleTesting::Method MultipleTesting::method(const QByteArray& name)
+{
+	QByteArray tmp = name.toLower();
+	if (tmp=="none") return Method::NONE;
+	if (tmp=="bonferroni") return Method::BONFERRONI;
+	if (tmp=="holm") return Method::HOLM;
+	if (tmp=="bh" || tmp=="fdr") return Method::BH;
+	if (tmp=="by") return Method::BY;
+	if (tmp=="qvalue") return Method::QVALUE;
+
+	THROW(ArgumentException, "Invalid multiple-testing correction method '" + name + "'! Valid methods are: 'none', 'bonferroni', 'holm', 'bh', 'by', 'qvalue'");
+}
+
+void MultipleTesting::adjust(QVector<double>& p_values, Method method, int threads)
+{
+	switch(method)
+	{
+		case Method::NONE:
+			break;
+		case Method::BONFERRONI:
+			bonferroni(p_values);
+			break;
+		case Method::HOLM:
+			holm(p_values, threads);
+			break;
+		case Method::BH:
+			benjaminiHochberg(p_values, threads);
+			break;
+		case Method::BY:
+			benjaminiYekutieli(p_values, threads);
+			break;
+		case Method::QVALUE:
+			qValues(p_values, 0.5, threads);
+			break;
+	}
+}
+
+void MultipleTesting::bonferroni(QVector<double>& p_values)
+{
+	qint64 m = 0;
+	foreach(double p, p_values)
+	{
+		if (std::isnan(p)) continue;
+		if (p<0.0 || p>1.0) THROW(ArgumentException, "Invalid p-value " + QString::number(p) + "! Must be in range [0, 1].");
+		++m;
+	}
+
+	for (int i=0; i<p_values.count(); ++i)
+	{
+		if (std::isnan(p_values[i])) continue;
+		p_values[i] = std::min(1.0, p_values[i] * m);
+	}
+}
+
+void MultipleTesting::holm(QVector<double>& p_values, int threads)
+{
+	QVector<Entry> entries = sortedEntries(p_values, threads);
+
+	//step-down: cumulative maximum of (m-i+1)*p from the smallest p-value
+	const qint64 m = entries.count();
+	double max = 0.0;
+	for (qint64 i=0; i<m; ++i)
+	{
+		max = std::max(max, std::min(1.0, (m - i) * entries[i].p));
+		p_values[entries[i].index] = max;
+	}
+}
+
+void MultipleTesting::benjaminiHochberg(QVector<double>& p_values, int threads)
+{
+	stepUp(p_values, 1.0, threads);
+}
+
+void MultipleTesting::benjaminiYekutieli(QVector<double>& p_values, int threads)
+{
+	qint64 m = std::count_if(p_values.cbegin(), p_values.cend(), [](double p){ return !std::isnan(p); });
+	//summed in ascending order like sum(1/(1:n)) in R's p.adjust
+	double harmonic = 0.0;
+	for (qint64 k=1; k<=m; ++k)
+	{
+		harmonic += 1.0 / k;
+	}
+
+	stepUp(p_values, harmonic, threads);
+}
+
+void MultipleTesting::qValues(QVector<double>& p_values, double lambda, int threads)
+{
+	if (!(lambda>=0.0 && lambda<1.0)) THROW(ArgumentException, "Invalid lambda " + QString::number(lambda) + " for q-value calculation! Must be in range [0, 1).");
+
+	stepUp(p_values, nullProportion(p_values, lambda), threads);
+}
+
+double MultipleTesting::nullProportion(const QVector<double>& p_values, double lambda)
+{
+	qint64 m = 0;
+	qint64 above = 0;
+	foreach(double p, p_values)
+	{
+		if (std::isnan(p)) continue;
+		++m;
+		if (p>lambda) ++above;
+	}
+	if (m==0) return 1.0;
+
+	return std::min(1.0, above / (m * (1.0 - lambda)));
+}
+
+QVector<double> MultipleTesting::fishersExactTest(const QVector<int>& a, const QVector<int>& b, const QVector<int>& c, const QVector<int>& d, BasicStatistics::FisherTestType type, Method method, int threads)
+{
+	QVector<double> output = BasicStatistics::fishersExactTest(a, b, c, d, type, threads);
+	adjust(output, method, threads);
+	return output;
+}
+
+QVector<MultipleTesting::Entry> MultipleTesting::sortedEntries(const QVector<double>& p_values, int threads)
+{
+	QVector<Entry> output;
+	output.reserve(p_values.count());
+	for (int i=0; i<p_values.count(); ++i)
+	{
+		double p = p_values[i];
+		if (std::isnan(p)) continue;
+		if (p<0.0 || p>1.0) THROW(ArgumentException, "Invalid p-value " + QString::number(p) + "! Must be in range [0, 1].");
+		output.append(Entry{p, i});
+	}
+
+	parallelSort(output, threads);
+
+	return output;
+}
+
+void MultipleTesting::stepUp(QVector<double>& p_values, double factor, int threads)
+{
+	QVector<Entry> entries = sortedEntries(p_values, threads);
+
+	//step-up: cumulative minimum of factor*m/i*p from the largest p-value
+	const qint64 m = entries.count();
+	double min = 1.0;
+	for (qint64 i=m-1; i>=0; --i)
+	{
+		min = std::min(min, factor * m / (i + 1) * entries[i].p);
+		p_values[entries[i].index] = min;
+	}
+}
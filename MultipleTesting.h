@@ -0,0 +1,72 @@
+#ifndef MULTIPLETESTING_H
+#define MULTIPLETESTING_H
+
+#include "cppCORE_global.h"
+#include "BasicStatistics.h"
+#include <QVector>
+#include <QByteArray>
+
+/**
+  @brief Multiple-testing correction of (large) p-value arrays.
+
+  The p-values are adjusted in place: they are sorted once (in parallel for large arrays) together with their original index, the adjusted values are calculated in a single pass over the sorted values and written back in the original order.
+  NaN values are kept and do not count as tests, like in R's p.adjust.
+*/
+class CPPCORESHARED_EXPORT MultipleTesting
+{
+public:
+	///Correction method.
+	enum class Method
+	{
+		NONE, ///< No correction.
+		BONFERRONI, ///< Bonferroni (family-wise error rate).
+		HOLM, ///< Holm step-down (family-wise error rate, uniformly more powerful than Bonferroni).
+		BH, ///< Benjamini-Hochberg (false discovery rate, independent or positively dependent tests).
+		BY, ///< Benjamini-Yekutieli (false discovery rate, arbitrary dependency).
+		QVALUE ///< Storey's q-values (false discovery rate, with estimated proportion of true null hypotheses).
+	};
+
+	///Converts a method name ('none', 'bonferroni', 'holm', 'bh', 'by' or 'qvalue') to the enum. Throws an exception if the name is invalid.
+	static Method method(const QByteArray& name);
+
+	///Adjusts the p-values in place using the given method. If @p threads is 0, the ideal thread count is used.
+	static void adjust(QVector<double>& p_values, Method method, int threads = 0);
+	///Bonferroni correction: p*m, bounded to 1.
+	static void bonferroni(QVector<double>& p_values);
+	///Holm step-down correction.
+	static void holm(QVector<double>& p_values, int threads = 0);
+	///Benjamini-Hochberg false discovery rate correction.
+	static void benjaminiHochberg(QVector<double>& p_values, int threads = 0);
+	///Benjamini-Yekutieli false discovery rate correction.
+	static void benjaminiYekutieli(QVector<double>& p_values, int threads = 0);
+	///Storey's q-values. The proportion of true null hypotheses is estimated from the p-values larger than @p lambda.
+	static void qValues(QVector<double>& p_values, double lambda = 0.5, int threads = 0);
+	///Returns the estimated proportion of true null hypotheses (Storey's pi0) for a given @p lambda, bounded to 1.
+	static double nullProportion(const QVector<double>& p_values, double lambda = 0.5);
+
+	///Batch Fisher's Exact Test (see BasicStatistics::fishersExactTest) followed by multiple-testing correction of the p-values.
+	static QVector<double> fishersExactTest(const QVector<int>& a, const QVector<int>& b, const QVector<int>& c, const QVector<int>& d, BasicStatistics::FisherTestType type, Method method, int threads = 0);
+
+	///Minimum array size for the parallel sort.
+	static constexpr int PARALLEL_SORT_MIN_SIZE = 131072;
+
+protected:
+	//p-value and its index in the original array
+	struct Entry
+	{
+		double p;
+		int index;
+
+		bool operator<(const Entry& rhs) const
+		{
+			return p<rhs.p || (p==rhs.p && index<rhs.index);
+		}
+	};
+
+	//checks the p-values and returns the valid (non-NaN) p-values sorted ascending, with their index
+	static QVector<Entry> sortedEntries(const QVector<double>& p_values, int threads);
+	//adjusts the p-values with a step-up procedure: adjusted p-value of rank i (1-based) is the minimum of factor*m/j*p over all ranks j>=i, bounded to 1
+	static void stepUp(QVector<double>& p_values, double factor, int threads);
+};
+
+#endif // MULTIPLETESTING_H
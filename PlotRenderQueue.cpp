@@ -0,0 +1,58 @@
+#include "PlotRenderQueue.h"
+#include "Exceptions.h"
+
+#include <QThread>
+#include <algorithm>
+#include <QtConcurrent>
+
+PlotRenderQueue::PlotRenderQueue(int threads)
+{
+	pool_.setMaxThreadCount(threads>0 ? threads : std::max(1, QThread::idealThreadCount()));
+
+	// load the fonts on the GUI thread before rendering in worker threads
+	PlotRenderer::fontFamily();
+}
+
+PlotRenderQueue::~PlotRenderQueue()
+{
+	pool_.waitForDone();
+}
+
+void PlotRenderQueue::add(const PlotRenderer& plot, QString filename)
+{
+	pending_ << QtConcurrent::run(&pool_, [plot, filename]()
+	{
+		try
+		{
+			plot.save(filename);
+		}
+		catch (Exception& e)
+		{
+			return e.message();
+		}
+		return QString();
+	});
+
+	collectFinished(false);
+}
+
+void PlotRenderQueue::waitForFinished()
+{
+	collectFinished(true);
+
+	if (!errors_.isEmpty())
+	{
+		QString message = "Could not render " + QString::number(errors_.count()) + " plot(s): " + errors_.join(" ");
+		errors_.clear();
+		THROW(FileAccessException, message);
+	}
+}
+
+void PlotRenderQueue::collectFinished(bool wait)
+{
+	while (!pending_.isEmpty() && (wait || pending_.first().isFinished()))
+	{
+		QString error = pending_.takeFirst().result();
+		if (!error.isEmpty()) errors_ << error;
+	}
+}
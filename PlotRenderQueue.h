@@ -0,0 +1,41 @@
+#ifndef PLOTRENDERQUEUE_H
+#define PLOTRENDERQUEUE_H
+
+#include "cppCORE_global.h"
+#include "PlotRenderer.h"
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QFuture>
+#include <QThreadPool>
+
+// Queue that renders plots to PNG, SVG or PDF files concurrently on worker threads (QPainter on a separate paint device per plot, see PlotRenderer).
+// Plots are rendered as soon as they are added. Typical usage: queue.add(plot.renderer(), filename) for each plot, then queue.waitForFinished().
+// Must be created on the thread of the QGuiApplication.
+class CPPCORESHARED_EXPORT PlotRenderQueue
+{
+public:
+	//Constructor. If @p threads is 0, the ideal thread count is used.
+	PlotRenderQueue(int threads = 0);
+	//Destructor. Waits for all plots to be rendered (errors are ignored - use waitForFinished() to check for errors).
+	~PlotRenderQueue();
+
+	//adds a plot that is rendered to a file on a worker thread. The format is determined by the file extension (see PlotRenderer::save).
+	void add(const PlotRenderer& plot, QString filename);
+	//waits until all plots are rendered. Throws an exception if plots could not be rendered.
+	void waitForFinished();
+
+protected:
+	QThreadPool pool_;
+	QList<QFuture<QString>> pending_;
+	QStringList errors_;
+
+	//removes finished plots from the pending list and collects their errors
+	void collectFinished(bool wait);
+
+	//declared away
+	PlotRenderQueue(const PlotRenderQueue&) = delete;
+	PlotRenderQueue& operator=(const PlotRenderQueue&) = delete;
+};
+
+#endif // PLOTRENDERQUEUE_H
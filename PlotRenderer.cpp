@@ -0,0 +1,495 @@
+#include "PlotRenderer.h"
+#include "Exceptions.h"
+#include "BasicStatistics.h"
+
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <QGuiApplication>
+#include <QPainter>
+#include <QPolygonF>
+#include <QFont>
+#include <QFontMetricsF>
+#include <QFontDatabase>
+#include <QPainterPath>
+#include <QSvgGenerator>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QPageLayout>
+#include <QSet>
+
+//Returns a step of 1, 2 or 5 times a power of 10 that splits the range into about @p ticks intervals.
+static double niceStep(double range, int ticks)
+{
+	double raw = range / ticks;
+	double magnitude = std::pow(10.0, std::floor(std::log10(raw)));
+	double fraction = raw / magnitude;
+	double nice = fraction<=1.0 ? 1.0 : (fraction<=2.0 ? 2.0 : (fraction<=5.0 ? 5.0 : 10.0));
+	return nice * magnitude;
+}
+
+PlotRenderer::PlotRenderer(int width, int height)
+	: width_(width)
+	, height_(height)
+	, legend_visible_(true)
+{
+	x_.min = std::numeric_limits<double>::quiet_NaN();
+	x_.max = std::numeric_limits<double>::quiet_NaN();
+	y_.min = std::numeric_limits<double>::quiet_NaN();
+	y_.max = std::numeric_limits<double>::quiet_NaN();
+}
+
+void PlotRenderer::addLine(const QVector<QPointF>& points, QColor color, QString name, double width, Qt::PenStyle style)
+{
+	series_.append(Series{Series::LINE, points, color.isValid() ? color : nextColor(), QColor(), name, width, style, false});
+}
+
+void PlotRenderer::addPoints(const QVector<QPointF>& points, QColor color, QString name, double size, bool square)
+{
+	series_.append(Series{Series::POINTS, points, color.isValid() ? color : nextColor(), QColor(), name, size, Qt::SolidLine, square});
+}
+
+void PlotRenderer::addArea(const QVector<QPointF>& polygon, QColor color, QColor border, QString name)
+{
+	series_.append(Series{Series::AREA, polygon, color, border, name, 1.0, Qt::SolidLine, false});
+}
+
+void PlotRenderer::render(QPainter& painter) const
+{
+	if (!qobject_cast<QGuiApplication*>(QCoreApplication::instance())) THROW(ProgrammingException, "The code needs a running QGuiApplication to be able to render text in plots");
+
+	Axis x = finalAxis(true);
+	Axis y = finalAxis(false);
+
+	// fonts
+	QFont regular_font(fontFamily());
+	regular_font.setPixelSize(14);
+	regular_font.setWeight(QFont::Normal);
+	QFont bold_font(fontFamily());
+	bold_font.setPixelSize(14);
+	bold_font.setWeight(QFont::Bold);
+	QFont label_font(fontFamily());
+	label_font.setPixelSize(9);
+	QFontMetricsF regular_metrics(regular_font);
+	QFontMetricsF bold_metrics(bold_font);
+	QFontMetricsF label_metrics(label_font);
+
+	// tick labels
+	QStringList x_labels;
+	foreach(double tick, x.ticks)
+	{
+		x_labels << tickLabel(tick, (x.log || x.ticks.count()<2) ? 0.0 : x.ticks[1]-x.ticks[0]);
+	}
+	QStringList y_labels;
+	double y_labels_width = 0.0;
+	foreach(double tick, y.ticks)
+	{
+		y_labels << tickLabel(tick, (y.log || y.ticks.count()<2) ? 0.0 : y.ticks[1]-y.ticks[0]);
+		y_labels_width = std::max(y_labels_width, regular_metrics.horizontalAdvance(y_labels.last()));
+	}
+
+	// legend entries
+	QVector<int> legend;
+	for (int i=0; i<series_.count(); ++i)
+	{
+		if (legend_visible_ && !series_[i].name.isEmpty()) legend << i;
+	}
+
+	// layout
+	const double padding = 10.0;
+	double top = padding;
+	if (!title_.isEmpty()) top += bold_metrics.height() + padding;
+	const double legend_top = top;
+	if (!legend.isEmpty()) top += regular_metrics.height() + padding;
+	double left = padding + y_labels_width + padding/2;
+	if (!y.label.isEmpty()) left += bold_metrics.height() + padding/2;
+	double bottom = padding;
+	if (!x.label.isEmpty()) bottom += bold_metrics.height() + padding/2;
+	if (categories_.isEmpty())
+	{
+		bottom += regular_metrics.height() + padding/2;
+	}
+	else
+	{
+		double categories_width = 0.0;
+		foreach(const QString& category, categories_)
+		{
+			categories_width = std::max(categories_width, label_metrics.horizontalAdvance(category));
+		}
+		bottom += categories_width + padding/2;
+	}
+	double right = padding;
+	if (categories_.isEmpty() && !x_labels.isEmpty()) right += regular_metrics.horizontalAdvance(x_labels.last()) / 2;
+	const QRectF plot(left, top, width_ - left - right, height_ - top - bottom);
+
+	auto isValid = [&](const QPointF& p)
+	{
+		return BasicStatistics::isValidFloat(p.x()) && BasicStatistics::isValidFloat(p.y()) && (!x.log || p.x()>0.0) && (!y.log || p.y()>0.0);
+	};
+	auto toPixel = [&](const QPointF& p)
+	{
+		// bounded to avoid overflows of the paint engine for points far outside the plot area
+		double px = std::clamp(plot.left() + x.map(p.x()) * plot.width(), -1e6, 1e6);
+		double py = std::clamp(plot.bottom() - y.map(p.y()) * plot.height(), -1e6, 1e6);
+		return QPointF(px, py);
+	};
+
+	painter.save();
+	painter.setRenderHint(QPainter::Antialiasing, true);
+	painter.setRenderHint(QPainter::TextAntialiasing, true);
+	painter.fillRect(QRectF(0, 0, width_, height_), Qt::white);
+
+	// grid
+	painter.setPen(QPen(QColor(224, 224, 224), 1.0));
+	if (x.grid)
+	{
+		foreach(double tick, x.ticks)
+		{
+			double px = plot.left() + x.map(tick) * plot.width();
+			painter.drawLine(QPointF(px, plot.top()), QPointF(px, plot.bottom()));
+		}
+	}
+	if (y.grid)
+	{
+		foreach(double tick, y.ticks)
+		{
+			double py = plot.bottom() - y.map(tick) * plot.height();
+			painter.drawLine(QPointF(plot.left(), py), QPointF(plot.right(), py));
+		}
+	}
+
+	// series
+	painter.setClipRect(plot.adjusted(-1, -1, 1, 1));
+	foreach(const Series& series, series_)
+	{
+		if (series.type==Series::LINE)
+		{
+			QPen pen(series.color, series.size, series.style, Qt::RoundCap, Qt::RoundJoin);
+			painter.setPen(pen);
+			painter.setBrush(Qt::NoBrush);
+			QPolygonF segment;
+			foreach(const QPointF& p, series.points)
+			{
+				if (isValid(p))
+				{
+					// consecutive points at the same output position (quarter pixel) are skipped
+					QPointF pixel = toPixel(p);
+					if (segment.isEmpty() || std::fabs(pixel.x()-segment.last().x())>=0.25 || std::fabs(pixel.y()-segment.last().y())>=0.25) segment << pixel;
+				}
+				else
+				{
+					painter.drawPolyline(segment);
+					segment.clear();
+				}
+			}
+			painter.drawPolyline(segment);
+		}
+		else if (series.type==Series::POINTS)
+		{
+			// one path per series (one element in vector output). Markers outside the plot area or at the same output position (half pixel) are skipped.
+			const double radius = series.size / 2;
+			const QRectF visible = plot.adjusted(-radius, -radius, radius, radius);
+			QSet<quint64> drawn;
+			QPainterPath path;
+			path.setFillRule(Qt::WindingFill);
+			foreach(const QPointF& p, series.points)
+			{
+				if (!isValid(p)) continue;
+				QPointF center = toPixel(p);
+				if (!visible.contains(center)) continue;
+				quint64 key = (quint64(quint32(std::lround(2.0 * center.x()))) << 32) | quint32(std::lround(2.0 * center.y()));
+				if (drawn.contains(key)) continue;
+				drawn.insert(key);
+
+				if (series.square)
+				{
+					path.addRect(QRectF(center.x() - radius, center.y() - radius, series.size, series.size));
+				}
+				else
+				{
+					path.addEllipse(center, radius, radius);
+				}
+			}
+			painter.setPen(Qt::NoPen);
+			painter.setBrush(series.color);
+			painter.drawPath(path);
+		}
+		else
+		{
+			painter.setPen(series.border.isValid() ? QPen(series.border, series.size) : QPen(Qt::NoPen));
+			painter.setBrush(series.color);
+			QPolygonF polygon;
+			foreach(const QPointF& p, series.points)
+			{
+				polygon << toPixel(p);
+			}
+			painter.drawPolygon(polygon);
+		}
+	}
+	painter.setClipping(false);
+
+	// axes
+	painter.setPen(QPen(QColor(140, 140, 140), 1.0));
+	painter.drawLine(plot.bottomLeft(), plot.bottomRight());
+	painter.drawLine(plot.bottomLeft(), plot.topLeft());
+
+	// tick labels
+	painter.setPen(Qt::black);
+	if (categories_.isEmpty())
+	{
+		painter.setFont(regular_font);
+		for (int i=0; i<x.ticks.count(); ++i)
+		{
+			double px = plot.left() + x.map(x.ticks[i]) * plot.width();
+			painter.drawText(QRectF(px - 100, plot.bottom() + padding/2, 200, regular_metrics.height()), Qt::AlignHCenter|Qt::AlignTop, x_labels[i]);
+		}
+	}
+	else
+	{
+		// rotated category labels ending at the x axis
+		painter.setFont(label_font);
+		for (int i=0; i<categories_.count(); ++i)
+		{
+			double px = plot.left() + x.map(i) * plot.width();
+			double text_width = label_metrics.horizontalAdvance(categories_[i]);
+			painter.save();
+			painter.translate(px, plot.bottom() + padding/2);
+			painter.rotate(-90);
+			painter.drawText(QRectF(-text_width, -label_metrics.height()/2, text_width, label_metrics.height()), Qt::AlignRight|Qt::AlignVCenter, categories_[i]);
+			painter.restore();
+		}
+	}
+	painter.setFont(regular_font);
+	for (int i=0; i<y.ticks.count(); ++i)
+	{
+		double py = plot.bottom() - y.map(y.ticks[i]) * plot.height();
+		painter.drawText(QRectF(plot.left() - padding/2 - y_labels_width, py - regular_metrics.height()/2, y_labels_width, regular_metrics.height()), Qt::AlignRight|Qt::AlignVCenter, y_labels[i]);
+	}
+
+	// axis titles and plot title
+	painter.setFont(bold_font);
+	if (!x.label.isEmpty())
+	{
+		painter.drawText(QRectF(plot.left(), height_ - padding - bold_metrics.height(), plot.width(), bold_metrics.height()), Qt::AlignCenter, x.label);
+	}
+	if (!y.label.isEmpty())
+	{
+		painter.save();
+		painter.translate(padding, plot.center().y());
+		painter.rotate(-90);
+		painter.drawText(QRectF(-plot.height()/2, 0, plot.height(), bold_metrics.height()), Qt::AlignCenter, y.label);
+		painter.restore();
+	}
+	if (!title_.isEmpty())
+	{
+		painter.drawText(QRectF(0, padding, width_, bold_metrics.height()), Qt::AlignCenter, title_);
+	}
+
+	// legend (one centered row)
+	if (!legend.isEmpty())
+	{
+		const double marker_size = 12.0;
+		double legend_width = 0.0;
+		foreach(int i, legend)
+		{
+			legend_width += marker_size + padding/2 + regular_metrics.horizontalAdvance(series_[i].name) + 1.5*padding;
+		}
+		double pos = std::max(padding, (width_ - legend_width) / 2);
+		painter.setFont(regular_font);
+		foreach(int i, legend)
+		{
+			const Series& series = series_[i];
+			painter.fillRect(QRectF(pos, legend_top + (regular_metrics.height() - marker_size)/2, marker_size, marker_size), series.color);
+			pos += marker_size + padding/2;
+			double text_width = regular_metrics.horizontalAdvance(series.name);
+			painter.drawText(QRectF(pos, legend_top, text_width, regular_metrics.height()), Qt::AlignLeft|Qt::AlignVCenter, series.name);
+			pos += text_width + 1.5*padding;
+		}
+	}
+
+	painter.restore();
+}
+
+QImage PlotRenderer::toImage() const
+{
+	QImage image(width_, height_, QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::white);
+	QPainter painter(&image);
+	render(painter);
+	painter.end();
+	return image;
+}
+
+void PlotRenderer::savePng(QString filename) const
+{
+	if (!toImage().save(filename.replace("\\", "/"), "PNG"))
+	{
+		THROW(FileAccessException, "Could not save plot to the file: " + filename);
+	}
+}
+
+void PlotRenderer::saveSvg(QString filename) const
+{
+	QSvgGenerator generator;
+	generator.setFileName(filename.replace("\\", "/"));
+	generator.setSize(QSize(width_, height_));
+	generator.setViewBox(QRect(0, 0, width_, height_));
+	generator.setTitle(title_);
+
+	QPainter painter;
+	if (!painter.begin(&generator))
+	{
+		THROW(FileAccessException, "Could not save plot to the file: " + filename);
+	}
+	render(painter);
+	painter.end();
+}
+
+void PlotRenderer::savePdf(QString filename) const
+{
+	// one pixel corresponds to one point
+	QPdfWriter writer(filename.replace("\\", "/"));
+	writer.setPageSize(QPageSize(QSizeF(width_, height_), QPageSize::Point));
+	writer.setPageMargins(QMarginsF(0, 0, 0, 0), QPageLayout::Point);
+	writer.setResolution(72);
+	writer.setTitle(title_);
+
+	QPainter painter;
+	if (!painter.begin(&writer))
+	{
+		THROW(FileAccessException, "Could not save plot to the file: " + filename);
+	}
+	render(painter);
+	painter.end();
+}
+
+void PlotRenderer::save(QString filename) const
+{
+	QString suffix = filename.section('.', -1).toLower();
+	if (suffix=="png")
+	{
+		savePng(filename);
+	}
+	else if (suffix=="svg")
+	{
+		saveSvg(filename);
+	}
+	else if (suffix=="pdf")
+	{
+		savePdf(filename);
+	}
+	else
+	{
+		THROW(ArgumentException, "Unsupported plot file format '" + suffix + "' of file " + filename + "! Valid formats are: 'png', 'svg', 'pdf'");
+	}
+}
+
+QString PlotRenderer::fontFamily()
+{
+	// loaded on first use only (thread-safe initialization of static variables)
+	static const QString family = []()
+	{
+		int font_id = QFontDatabase::addApplicationFont(":/fonts/Arimo-Regular.ttf");
+		QFontDatabase::addApplicationFont(":/fonts/Arimo-Bold.ttf");
+		QFontDatabase::addApplicationFont(":/fonts/Arimo-Medium.ttf");
+		QStringList families = QFontDatabase::applicationFontFamilies(font_id);
+		if (families.isEmpty()) THROW(ProgrammingException, "Could not load the embedded Arimo font!");
+		return families.at(0);
+	}();
+
+	return family;
+}
+
+double PlotRenderer::Axis::map(double value) const
+{
+	if (log)
+	{
+		return (std::log10(value) - std::log10(min)) / (std::log10(max) - std::log10(min));
+	}
+	return (value - min) / (max - min);
+}
+
+QColor PlotRenderer::nextColor() const
+{
+	// default series colors of the QtCharts light theme
+	static const QColor colors[] = {QColor(0x20, 0x9f, 0xdf), QColor(0x99, 0xca, 0x53), QColor(0xf6, 0xa6, 0x25), QColor(0x6d, 0x5f, 0xd5), QColor(0xbf, 0x59, 0x3e)};
+	return colors[series_.count() % 5];
+}
+
+PlotRenderer::Axis PlotRenderer::finalAxis(bool x) const
+{
+	Axis axis = x ? x_ : y_;
+
+	// range from data (extended to nice numbers)
+	bool range_set = BasicStatistics::isValidFloat(axis.min) && BasicStatistics::isValidFloat(axis.max) && axis.max>axis.min && (!axis.log || axis.min>0.0);
+	if (!range_set)
+	{
+		double min = std::numeric_limits<double>::max();
+		double max = -std::numeric_limits<double>::max();
+		foreach(const Series& series, series_)
+		{
+			foreach(const QPointF& p, series.points)
+			{
+				double value = x ? p.x() : p.y();
+				if (!BasicStatistics::isValidFloat(value) || (axis.log && value<=0.0)) continue;
+				min = std::min(min, value);
+				max = std::max(max, value);
+			}
+		}
+
+		if (min>max)
+		{
+			min = axis.log ? 1.0 : 0.0;
+			max = axis.log ? 10.0 : 1.0;
+		}
+		if (axis.log)
+		{
+			axis.min = std::pow(10.0, std::floor(std::log10(min)));
+			axis.max = std::pow(10.0, std::ceil(std::log10(max)));
+			if (axis.max<=axis.min) axis.max = axis.min * 10.0;
+		}
+		else
+		{
+			if (max==min)
+			{
+				min -= 0.5;
+				max += 0.5;
+			}
+			double step = niceStep(max - min, 5);
+			axis.min = std::floor(min / step) * step;
+			axis.max = std::ceil(max / step) * step;
+		}
+	}
+
+	// ticks
+	axis.ticks.clear();
+	if (axis.log)
+	{
+		int first = static_cast<int>(std::ceil(std::log10(axis.min) - 1e-9));
+		int last = static_cast<int>(std::floor(std::log10(axis.max) + 1e-9));
+		int step = std::max(1, (last - first) / 10 + 1);
+		for (int e=first; e<=last; e+=step)
+		{
+			axis.ticks << std::pow(10.0, e);
+		}
+	}
+	else
+	{
+		double step = niceStep(axis.max - axis.min, 5);
+		double first = std::ceil(axis.min / step - 1e-9) * step;
+		for (int i=0; first + i * step <= axis.max + 1e-9 * step; ++i)
+		{
+			axis.ticks << first + i * step;
+		}
+	}
+
+	return axis;
+}
+
+QString PlotRenderer::tickLabel(double value, double step)
+{
+	// rounding errors of ticks close to zero
+	if (step>0.0 && std::fabs(value) < 1e-9 * step) value = 0.0;
+
+	return QString::number(value, 'g', 6);
+}
@@ -0,0 +1,157 @@
+#ifndef PLOTRENDERER_H
+#define PLOTRENDERER_H
+
+#include "cppCORE_global.h"
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QPointF>
+#include <QColor>
+#include <QImage>
+
+class QPainter;
+
+// Lightweight plot renderer that draws axes, series and legend directly with QPainter, i.e. without QtCharts and the widget stack.
+// A renderer is a copyable plot specification. Different renderers can be rendered in parallel on different threads.
+// Besides PNG, plots can be written as SVG or PDF. The primitives are streamed to the file. Markers are drawn as one path per series, with markers at the same output position merged, so the file size is bounded by the plot size.
+// Note: text rendering needs a QGuiApplication (QCoreApplication is not sufficient for fonts), but not a QApplication. On servers use the 'offscreen' or 'minimal' platform.
+class CPPCORESHARED_EXPORT PlotRenderer
+{
+public:
+	PlotRenderer(int width = 600, int height = 400);
+
+	void setSize(int width, int height)
+	{
+		width_ = width;
+		height_ = height;
+	}
+	int width() const
+	{
+		return width_;
+	}
+	int height() const
+	{
+		return height_;
+	}
+	void setTitle(QString title)
+	{
+		title_ = title;
+	}
+	void setXLabel(QString xlabel)
+	{
+		x_.label = xlabel;
+	}
+	void setYLabel(QString ylabel)
+	{
+		y_.label = ylabel;
+	}
+	//sets the x range. If not set, the range is determined from the data and extended to nice numbers.
+	void setXRange(double xmin, double xmax)
+	{
+		x_.min = xmin;
+		x_.max = xmax;
+	}
+	//sets the y range. If not set, the range is determined from the data and extended to nice numbers.
+	void setYRange(double ymin, double ymax)
+	{
+		y_.min = ymin;
+		y_.max = ymax;
+	}
+	void setXLogScale(bool log_scale)
+	{
+		x_.log = log_scale;
+	}
+	void setYLogScale(bool log_scale)
+	{
+		y_.log = log_scale;
+	}
+	void setXGridVisible(bool visible)
+	{
+		x_.grid = visible;
+	}
+	//sets category labels drawn rotated below the x positions 0, 1, 2, ... (replaces the x axis tick labels)
+	void setXCategories(const QStringList& categories)
+	{
+		categories_ = categories;
+	}
+	void setLegendVisible(bool visible)
+	{
+		legend_visible_ = visible;
+	}
+
+	//adds a line. NaN values split the line. If the color is invalid, the next default series color is used.
+	void addLine(const QVector<QPointF>& points, QColor color = QColor(), QString name = "", double width = 1.5, Qt::PenStyle style = Qt::SolidLine);
+	//adds markers with the given size in pixels (circles or squares). If the color is invalid, the next default series color is used.
+	void addPoints(const QVector<QPointF>& points, QColor color = QColor(), QString name = "", double size = 6.0, bool square = false);
+	//adds a filled polygon. If the border color is invalid, no border is drawn.
+	void addArea(const QVector<QPointF>& polygon, QColor color, QColor border = QColor(), QString name = "");
+
+	//renders the plot into the rectangle (0, 0, width, height) of the painter
+	void render(QPainter& painter) const;
+	//renders the plot into an image
+	QImage toImage() const;
+	//renders the plot into a PNG file
+	void savePng(QString filename) const;
+	//renders the plot into a SVG file
+	void saveSvg(QString filename) const;
+	//renders the plot into a PDF file (one page of the plot size in points)
+	void savePdf(QString filename) const;
+	//renders the plot into a PNG, SVG or PDF file, depending on the file extension
+	void save(QString filename) const;
+
+	//returns the family of the embedded Arimo font. The fonts are loaded once.
+	static QString fontFamily();
+
+protected:
+	//series representation
+	struct Series
+	{
+		enum Type
+		{
+			LINE,
+			POINTS,
+			AREA
+		};
+
+		Type type;
+		QVector<QPointF> points;
+		QColor color;
+		QColor border;
+		QString name;
+		double size;
+		Qt::PenStyle style;
+		bool square;
+	};
+
+	//axis representation
+	struct Axis
+	{
+		QString label;
+		double min;
+		double max;
+		bool log = false;
+		bool grid = true;
+		QVector<double> ticks;
+
+		//maps a value to the range [0, 1]
+		double map(double value) const;
+	};
+
+	int width_;
+	int height_;
+	QString title_;
+	QStringList categories_;
+	bool legend_visible_;
+	Axis x_;
+	Axis y_;
+	QVector<Series> series_;
+
+	//returns the next default series color
+	QColor nextColor() const;
+	//returns the axis with range (from the data if not set) and ticks
+	Axis finalAxis(bool x) const;
+	//returns the tick label of a value
+	static QString tickLabel(double value, double step);
+};
+
+#endif // PLOTRENDERER_H
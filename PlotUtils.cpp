@@ -1,9 +1,9 @@
 #include "PlotUtils.h"
 #include "Exceptions.h"
 #include "Log.h"
+#include "PlotRenderer.h"
 
 #include <QApplication>
-#include <QFontDatabase>
 #include <QLineSeries>
 #include <QAreaSeries>
 #include <QLegendMarker>
@@ -26,10 +26,8 @@ QChart *PlotUtils::getChart()
 
 void PlotUtils::applyFontSettings()
 {
-	int font_id = QFontDatabase::addApplicationFont(":/fonts/Arimo-Regular.ttf");
-	QFontDatabase::addApplicationFont(":/fonts/Arimo-Bold.ttf");
-	QFontDatabase::addApplicationFont(":/fonts/Arimo-Medium.ttf");
-	QString font_family = QFontDatabase::applicationFontFamilies(font_id).at(0);
+	// embedded fonts are loaded once and shared with PlotRenderer
+	QString font_family = PlotRenderer::fontFamily();
 
 	QFont regular_font = QFont(font_family);
 	regular_font.setPixelSize(14);
@@ -50,8 +48,7 @@ void PlotUtils::applyFontSettings()
 
 QFont PlotUtils::getLabelFont()
 {
-	int font_id = QFontDatabase::addApplicationFont(":/fonts/Arimo-Regular.ttf");
-	QString font_family = QFontDatabase::applicationFontFamilies(font_id).at(0);
+	QString font_family = PlotRenderer::fontFamily();
 	QFont label_font = QFont(font_family);
 	label_font.setPixelSize(9);
 	return label_font;
@@ -0,0 +1,194 @@
+#include "QuantileSketch.h"
+#include "Exceptions.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+QuantileSketch::QuantileSketch(double compression)
+	: compression_(compression)
+{
+	if (compression_<10.0) THROW(ArgumentException, "Invalid quantile sketch compression " + QString::number(compression_) + " - at least 10 is required!");
+
+	clear();
+}
+
+void QuantileSketch::add(double value)
+{
+	if (!std::isfinite(value))
+	{
+		++invalid_;
+		return;
+	}
+
+	++count_;
+	if (value<min_) min_ = value;
+	if (value>max_) max_ = value;
+
+	buffer_.append(Centroid{value, 1.0});
+	if (buffer_.count()>=5*compression_) compress();
+}
+
+void QuantileSketch::add(const QVector<double>& data)
+{
+	foreach(double value, data)
+	{
+		add(value);
+	}
+}
+
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+	invalid_ += other.invalid_;
+	if (other.count_==0) return;
+
+	other.compress();
+	count_ += other.count_;
+	min_ = std::min(min_, other.min_);
+	max_ = std::max(max_, other.max_);
+	buffer_ << other.centroids_;
+	compress();
+}
+
+void QuantileSketch::clear()
+{
+	count_ = 0;
+	invalid_ = 0;
+	min_ = std::numeric_limits<double>::max();
+	max_ = -std::numeric_limits<double>::max();
+	centroids_.clear();
+	buffer_.clear();
+	buffer_.reserve(5 * compression_);
+}
+
+int QuantileSketch::centroidCount() const
+{
+	compress();
+	return centroids_.count();
+}
+
+double QuantileSketch::k(double q) const
+{
+	return compression_ / (2.0 * M_PI) * std::asin(2.0 * q - 1.0);
+}
+
+double QuantileSketch::kInverse(double k) const
+{
+	return (std::sin(std::min(k * 2.0 * M_PI / compression_, M_PI / 2.0)) + 1.0) / 2.0;
+}
+
+void QuantileSketch::compress() const
+{
+	if (buffer_.isEmpty()) return;
+
+	//sort centroids and buffered values by mean
+	buffer_ << centroids_;
+	std::sort(buffer_.begin(), buffer_.end(), [](const Centroid& a, const Centroid& b){ return a.mean<b.mean; });
+	double total = 0.0;
+	foreach(const Centroid& c, buffer_)
+	{
+		total += c.weight;
+	}
+
+	//merge neighbors as long as the size limit of the scale function is not exceeded
+	centroids_.clear();
+	Centroid current = buffer_[0];
+	double weight_before = 0.0;
+	double q_limit = kInverse(k(0.0) + 1.0);
+	for (int i=1; i<buffer_.count(); ++i)
+	{
+		const Centroid& next = buffer_[i];
+		if ((weight_before + current.weight + next.weight) / total <= q_limit)
+		{
+			current.weight += next.weight;
+			current.mean += (next.mean - current.mean) * next.weight / current.weight;
+		}
+		else
+		{
+			weight_before += current.weight;
+			centroids_.append(current);
+			q_limit = kInverse(k(weight_before / total) + 1.0);
+			current = next;
+		}
+	}
+	centroids_.append(current);
+
+	buffer_.clear();
+}
+
+double QuantileSketch::quantile(double q) const
+{
+	if (count_==0) THROW(StatisticsException, "Cannot calculate quantile on empty data!");
+	if (q<0.0 || q>1.0) THROW(ArgumentException, "Invalid quantile " + QString::number(q) + " - must be in [0,1]!");
+
+	compress();
+	if (centroids_.count()==1) return centroids_[0].mean;
+
+	//between minimum and center of first centroid
+	const double index = q * count_;
+	const Centroid& first = centroids_.first();
+	if (index<first.weight/2.0)
+	{
+		return min_ + (first.mean - min_) * index / (first.weight/2.0);
+	}
+
+	//between centers of two centroids
+	double center = first.weight/2.0;
+	for (int i=0; i<centroids_.count()-1; ++i)
+	{
+		const Centroid& left = centroids_[i];
+		const Centroid& right = centroids_[i+1];
+		double next_center = center + (left.weight + right.weight) / 2.0;
+		if (index<next_center)
+		{
+			return left.mean + (right.mean - left.mean) * (index - center) / (next_center - center);
+		}
+		center = next_center;
+	}
+
+	//between center of last centroid and maximum
+	const Centroid& last = centroids_.last();
+	double fraction = std::min(1.0, (index - center) / (last.weight/2.0));
+	return last.mean + (max_ - last.mean) * fraction;
+}
+
+double QuantileSketch::cdf(double value) const
+{
+	if (count_==0) THROW(StatisticsException, "Cannot calculate CDF on empty data!");
+
+	compress();
+	if (value<min_) return 0.0;
+	if (value>=max_) return 1.0;
+
+	//interpolate the rank between the centroid centers (and minimum/maximum at the ends)
+	double prev_mean = min_;
+	double prev_rank = 0.0;
+	double rank = 0.0;
+	foreach(const Centroid& c, centroids_)
+	{
+		double center_rank = rank + c.weight/2.0;
+		if (value<c.mean)
+		{
+			double fraction = (c.mean>prev_mean) ? (value - prev_mean) / (c.mean - prev_mean) : 1.0;
+			return (prev_rank + (center_rank - prev_rank) * fraction) / count_;
+		}
+		prev_mean = c.mean;
+		prev_rank = center_rank;
+		rank += c.weight;
+	}
+	double fraction = (value - prev_mean) / (max_ - prev_mean);
+	return (prev_rank + (count_ - prev_rank) * fraction) / count_;
+}
+
+double QuantileSketch::min() const
+{
+	if (count_==0) THROW(StatisticsException, "Cannot calculate minimum on empty data!");
+
+	return min_;
+}
+
+double QuantileSketch::max() const
+{
+	if (count_==0) THROW(StatisticsException, "Cannot calculate maximum on empty data!");
+
+	return max_;
+}
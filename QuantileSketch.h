@@ -0,0 +1,95 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include "cppCORE_global.h"
+#include <QVector>
+
+/**
+  @brief Mergeable quantile sketch with bounded memory (merging t-digest of Dunning and Ertl).
+
+  Values are summarized by weighted centroids. Centroids near the tails are kept small, so that extreme quantiles are more accurate than quantiles near the median.
+  The memory usage depends only on the compression parameter: at most about 'compression' centroids plus a buffer of 5 x 'compression' values.
+  Sketches of several threads or data chunks can be combined using merge().
+  Invalid values (NaN, infinity) are not used, but counted separately.
+  Note: the query methods compress the buffer, so they must not be called concurrently on the same sketch.
+*/
+class CPPCORESHARED_EXPORT QuantileSketch
+{
+public:
+	///Constructor. Higher compression means higher accuracy and memory usage. Typical values are 100 to 500 (relative rank error of about 1% to 0.1% near the median).
+	QuantileSketch(double compression = 200.0);
+
+	///Adds a value.
+	void add(double value);
+	///Adds all values of an array.
+	void add(const QVector<double>& data);
+	///Merges the values of another sketch into this sketch.
+	void merge(const QuantileSketch& other);
+	///Resets the sketch.
+	void clear();
+
+	///Returns the number of valid values.
+	qint64 count() const
+	{
+		return count_;
+	}
+	///Returns the number of invalid values, which were ignored.
+	qint64 invalidCount() const
+	{
+		return invalid_;
+	}
+	///Returns the compression parameter.
+	double compression() const
+	{
+		return compression_;
+	}
+	///Returns the number of centroids (after compressing the buffer).
+	int centroidCount() const;
+
+	///Returns the approximate quantile (@p q in [0,1]).
+	double quantile(double q) const;
+	///Returns the approximate fraction of values that are less than or equal to @p value.
+	double cdf(double value) const;
+	///Returns the approximate median.
+	double median() const
+	{
+		return quantile(0.5);
+	}
+	///Returns the approximate first quartile.
+	double q1() const
+	{
+		return quantile(0.25);
+	}
+	///Returns the approximate third quartile.
+	double q3() const
+	{
+		return quantile(0.75);
+	}
+	///Returns the minimum (exact).
+	double min() const;
+	///Returns the maximum (exact).
+	double max() const;
+
+protected:
+	struct Centroid
+	{
+		double mean;
+		double weight;
+	};
+
+	double compression_;
+	qint64 count_;
+	qint64 invalid_;
+	double min_;
+	double max_;
+	mutable QVector<Centroid> centroids_;
+	mutable QVector<Centroid> buffer_;
+
+	//merges the buffer into the centroids
+	void compress() const;
+	//scale function k1 and its inverse
+	double k(double q) const;
+	double kInverse(double k) const;
+};
+
+#endif // QUANTILESKETCH_H
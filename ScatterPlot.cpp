@@ -8,6 +8,10 @@
 #include <QLogValueAxis>
 #include <QChartView>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <cmath>
 
 #include "Exceptions.h"
 #include "Log.h"
@@ -18,30 +22,46 @@ ScatterPlot::ScatterPlot()
 	: yrange_set_(false)
 	, xrange_set_(false)
 	, yscale_log_(false)
+	, density_mode_(AUTO)
+	, grid_width_(300)
+	, grid_height_(200)
 {
 }
 
-void ScatterPlot::store(QString filename)
+void ScatterPlot::determineRanges()
 {
-	if (points_.isEmpty())
-	{
-		Log::warn("ScatterPlot does not have any points to plot");
-		return;
-	}
-
 	if (!yrange_set_)
 	{
 		double min = std::numeric_limits<double>::max();
 		double max = -std::numeric_limits<double>::max();
 
-		for (const auto& p : points_)
+		//log scale > range of the positive values, padded in log space (linear padding would make the minimum negative)
+		if (yscale_log_)
 		{
-			min = std::min(min, p.second);
-			max = std::max(max, p.second);
+			for (const auto& p : points_)
+			{
+				if (!(p.second>0.0)) continue;
+				min = std::min(min, std::log10(p.second));
+				max = std::max(max, std::log10(p.second));
+			}
+		}
+
+		if (min<=max)
+		{
+			ymin_ = std::pow(10.0, min - 0.01 * (max - min));
+			ymax_ = std::pow(10.0, max + 0.01 * (max - min));
 		}
+		else
+		{
+			for (const auto& p : points_)
+			{
+				min = std::min(min, p.second);
+				max = std::max(max, p.second);
+			}
 
-		ymin_ = min - 0.01 * (max - min);
-		ymax_ = max + 0.01 * (max - min);
+			ymin_ = min - 0.01 * (max - min);
+			ymax_ = max + 0.01 * (max - min);
+		}
 	}
 
 	if (!xrange_set_)
@@ -58,6 +78,253 @@ void ScatterPlot::store(QString filename)
 		xmin_ = min-0.01*(max-min);
 		xmax_ = max+0.01*(max-min);
 	}
+}
+
+QPointF ScatterPlot::DensityGrid::center(int column, int row) const
+{
+	double x = xmin + (column + 0.5) * (xmax - xmin) / width;
+	double y = ymin + (row + 0.5) * (ymax - ymin) / height;
+	if (ylog) y = std::pow(10.0, y);
+	return QPointF(x, y);
+}
+
+ScatterPlot::DensityGrid ScatterPlot::densityGrid(int width, int height, int threads)
+{
+	if (width<=0 || height<=0)
+	{
+		THROW(ArgumentException, "Invalid density grid size " + QString::number(width) + "x" + QString::number(height) + "!");
+	}
+	determineRanges();
+
+	DensityGrid grid;
+	grid.width = width;
+	grid.height = height;
+	grid.xmin = xmin_;
+	grid.xmax = xmax_;
+	grid.ylog = yscale_log_;
+	grid.ymin = yscale_log_ ? std::log10(ymin_) : ymin_;
+	grid.ymax = yscale_log_ ? std::log10(ymax_) : ymax_;
+
+	//widen zero-width ranges like PlotRenderer does for the axes (otherwise all points would be dropped)
+	if (grid.xmax<=grid.xmin)
+	{
+		grid.xmin -= 0.5;
+		grid.xmax += 0.5;
+	}
+	if (grid.ymax<=grid.ymin)
+	{
+		double delta = yscale_log_ ? 1.0 : 0.5;
+		grid.ymin -= delta;
+		grid.ymax += delta;
+	}
+
+	//color index of each point
+	QHash<QString, int> color_index;
+	QVector<int> point_colors(points_.count());
+	for (int i=0; i<points_.count(); ++i)
+	{
+		QString color = (colors_.size() > i) ? colors_[i] : "black";
+		auto it = color_index.find(color);
+		if (it==color_index.end())
+		{
+			it = color_index.insert(color, grid.colors.count());
+			grid.colors << color;
+		}
+		point_colors[i] = it.value();
+	}
+
+	//bin points of a range into a grid
+	const qint64 cells = qint64(width) * height;
+	const double x_scale = width / (grid.xmax - grid.xmin);
+	const double y_scale = height / (grid.ymax - grid.ymin);
+	auto binPoints = [&](qsizetype start, qsizetype end, QVector<quint32>& counts)
+	{
+		for (qsizetype i=start; i<end; ++i)
+		{
+			double y = yscale_log_ ? std::log10(points_[i].second) : points_[i].second;
+			//values on the upper bound go to the last cell
+			double column = points_[i].first==grid.xmax ? width - 1 : (points_[i].first - grid.xmin) * x_scale;
+			double row = y==grid.ymax ? height - 1 : (y - grid.ymin) * y_scale;
+			if (!(column>=0.0 && column<width && row>=0.0 && row<height)) continue; //also skips NaN
+			++counts[point_colors[i]*cells + static_cast<int>(row)*width + static_cast<int>(column)];
+		}
+	};
+
+	//small data or single thread > bin directly
+	grid.counts.fill(0, grid.colors.count() * cells);
+	const int thread_count = threads>0 ? threads : std::max(1, QThread::idealThreadCount());
+	if (points_.count()<DENSITY_THRESHOLD || thread_count==1)
+	{
+		binPoints(0, points_.count(), grid.counts);
+		return grid;
+	}
+
+	//bin in parallel, one local grid per chunk
+	QVector<QVector<quint32>> local_counts(thread_count);
+	QVector<int> chunks;
+	for (int c=0; c<thread_count; ++c)
+	{
+		chunks << c;
+	}
+	const qsizetype chunk_size = (points_.count() + thread_count - 1) / thread_count;
+	QThreadPool pool;
+	pool.setMaxThreadCount(thread_count);
+	QtConcurrent::blockingMap(&pool, chunks, [&](int c)
+	{
+		local_counts[c].fill(0, grid.counts.count());
+		qsizetype start = std::min(c * chunk_size, points_.count());
+		binPoints(start, std::min(start + chunk_size, points_.count()), local_counts[c]);
+	});
+	foreach(const QVector<quint32>& counts, local_counts)
+	{
+		for (qsizetype i=0; i<counts.count(); ++i)
+		{
+			grid.counts[i] += counts[i];
+		}
+	}
+
+	return grid;
+}
+
+ScatterPlot::DensityMode ScatterPlot::plotDensityMode() const
+{
+	if (density_mode_==AUTO) return points_.count()>DENSITY_THRESHOLD ? DECIMATED : POINTS;
+	return density_mode_;
+}
+
+void ScatterPlot::pointsByColor(DensityMode mode, QList<QString>& colors, QList<QVector<QPointF>>& points)
+{
+	colors.clear();
+	points.clear();
+
+	if (mode==POINTS)
+	{
+		QHash<QString, int> color_index;
+		for (int i=0; i<points_.size(); ++i)
+		{
+			QString color = (colors_.size() > i) ? colors_[i] : "black";
+			auto it = color_index.find(color);
+			if (it==color_index.end())
+			{
+				it = color_index.insert(color, colors.count());
+				colors << color;
+				points << QVector<QPointF>();
+			}
+			points[it.value()] << QPointF(points_[i].first, points_[i].second);
+		}
+	}
+	else
+	{
+		// one point per non-empty cell and color
+		DensityGrid grid = densityGrid(grid_width_, grid_height_);
+		colors = grid.colors;
+		for (int c=0; c<grid.colors.count(); ++c)
+		{
+			QVector<QPointF> centers;
+			for (int row=0; row<grid.height; ++row)
+			{
+				for (int column=0; column<grid.width; ++column)
+				{
+					if (grid.count(c, column, row)>0) centers << grid.center(column, row);
+				}
+			}
+			points << centers;
+		}
+	}
+}
+
+QList<QVector<QPointF>> ScatterPlot::heatmapLevels(const DensityGrid& grid, int levels)
+{
+	// sum over colors
+	QVector<quint32> totals(grid.width * grid.height, 0);
+	quint32 max_count = 0;
+	for (int i=0; i<totals.count(); ++i)
+	{
+		for (int c=0; c<grid.colors.count(); ++c)
+		{
+			totals[i] += grid.counts[c*totals.count() + i];
+		}
+		max_count = std::max(max_count, totals[i]);
+	}
+
+	QList<QVector<QPointF>> output;
+	for (int level=0; level<levels; ++level)
+	{
+		output << QVector<QPointF>();
+	}
+	for (int i=0; i<totals.count(); ++i)
+	{
+		if (totals[i]==0) continue;
+		int level = std::min(levels-1, static_cast<int>(levels * std::log(totals[i]) / std::log(max_count + 1.0)));
+		output[level] << grid.center(i % grid.width, i / grid.width);
+	}
+
+	return output;
+}
+
+QColor ScatterPlot::heatmapColor(int level, int levels)
+{
+	// blue (few points) to red (many points)
+	return QColor::fromHsvF(0.65 * (1.0 - level / (levels - 1.0)), 0.9, 0.9);
+}
+
+double ScatterPlot::heatmapMarkerSize(const DensityGrid& grid)
+{
+	return std::max(2.0, 560.0 / grid.width);
+}
+
+PlotRenderer ScatterPlot::renderer()
+{
+	determineRanges();
+
+	PlotRenderer output(600, 400);
+	output.setXLabel(xlabel_);
+	output.setYLabel(ylabel_);
+	output.setYLogScale(yscale_log_);
+	if (BasicStatistics::isValidFloat(xmin_) && BasicStatistics::isValidFloat(xmax_)) output.setXRange(xmin_, xmax_);
+	if (BasicStatistics::isValidFloat(ymin_) && BasicStatistics::isValidFloat(ymax_)) output.setYRange(ymin_, ymax_);
+	output.setLegendVisible(color_legend_.count() > 0);
+
+	DensityMode mode = plotDensityMode();
+	if (mode==HEATMAP)
+	{
+		const int levels = 8;
+		DensityGrid grid = densityGrid(grid_width_, grid_height_);
+		QList<QVector<QPointF>> cells_by_level = heatmapLevels(grid, levels);
+		for (int level=0; level<levels; ++level)
+		{
+			output.addPoints(cells_by_level[level], heatmapColor(level, levels), "", heatmapMarkerSize(grid), true);
+		}
+	}
+	else
+	{
+		QList<QString> colors;
+		QList<QVector<QPointF>> points;
+		pointsByColor(mode, colors, points);
+		for (int c=0; c<colors.count(); ++c)
+		{
+			output.addPoints(points[c], QColor::fromString(colors[c]), color_legend_.value(colors[c], ""), 6.0);
+		}
+	}
+
+	// vertical lines
+	for (double x : vlines_)
+	{
+		output.addLine(QVector<QPointF>() << QPointF(x, ymin_) << QPointF(x, ymax_), Qt::black, "", 1.0, Qt::DashLine);
+	}
+
+	return output;
+}
+
+void ScatterPlot::store(QString filename)
+{
+	if (points_.isEmpty())
+	{
+		Log::warn("ScatterPlot does not have any points to plot");
+		return;
+	}
+
+	determineRanges();
 
 	PlotUtils* plot_utils = new PlotUtils();
 	QChart* chart = plot_utils->getChart();
@@ -65,11 +332,8 @@ void ScatterPlot::store(QString filename)
 
 	// group by color (Qt needs one series per color for legend support)
 	QMap<QString, QScatterSeries*> series_by_color;
-	for (int i=0; i<points_.size(); ++i)
+	auto seriesByColor = [&](const QString& color)
 	{
-		const auto& p = points_[i];
-		QString color = (colors_.size() > i) ? colors_[i] : "black";
-
 		if (!series_by_color.contains(color))
 		{
 			auto* s = new QScatterSeries();
@@ -89,8 +353,36 @@ void ScatterPlot::store(QString filename)
 			chart->addSeries(s);
 			series_by_color[color] = s;
 		}
+		return series_by_color[color];
+	};
 
-		series_by_color[color]->append(p.first, p.second);
+	DensityMode mode = plotDensityMode();
+	if (mode==HEATMAP)
+	{
+		const int levels = 8;
+		DensityGrid grid = densityGrid(grid_width_, grid_height_);
+		QList<QVector<QPointF>> cells_by_level = heatmapLevels(grid, levels);
+		for (int level=0; level<levels; ++level)
+		{
+			auto* s = new QScatterSeries();
+			s->setMarkerShape(QScatterSeries::MarkerShapeRectangle);
+			s->setMarkerSize(heatmapMarkerSize(grid));
+			s->setBorderColor(Qt::transparent);
+			s->setColor(heatmapColor(level, levels));
+			s->setName("");
+			s->append(cells_by_level[level]);
+			chart->addSeries(s);
+		}
+	}
+	else
+	{
+		QList<QString> colors;
+		QList<QVector<QPointF>> points;
+		pointsByColor(mode, colors, points);
+		for (int c=0; c<colors.count(); ++c)
+		{
+			seriesByColor(colors[c])->append(points[c]);
+		}
 	}
 
 	// vertical lines
@@ -5,11 +5,51 @@
 #include <QString>
 #include <QList>
 #include <QHash>
+#include <QVector>
+#include <QPointF>
+#include <QColor>
+#include "PlotRenderer.h"
 
 // Creates a scatter plot PNG image
 class CPPCORESHARED_EXPORT ScatterPlot
 {
 public:
+	//Rendering mode for large point sets
+	enum DensityMode
+	{
+		AUTO, //DECIMATED if there are more than DENSITY_THRESHOLD points, POINTS otherwise
+		POINTS, //one marker per point
+		DECIMATED, //one marker per non-empty grid cell and color
+		HEATMAP //one square per non-empty grid cell, colored by the number of points (log scale). Point colors are ignored.
+	};
+
+	//2D histogram of the points per color (see densityGrid())
+	struct DensityGrid
+	{
+		int width = 0;
+		int height = 0;
+		double xmin = 0.0;
+		double xmax = 0.0;
+		//y range (log10 of the range for log scale)
+		double ymin = 0.0;
+		double ymax = 0.0;
+		bool ylog = false;
+		QList<QString> colors;
+		//counts per color, row and column: index (color*height + row)*width + column
+		QVector<quint32> counts;
+
+		//returns the point count of a cell
+		quint32 count(int color, int column, int row) const
+		{
+			return counts[(color*height + row)*width + column];
+		}
+		//returns the center of a cell in data coordinates
+		QPointF center(int column, int row) const;
+	};
+
+	//minimum number of points for which AUTO mode decimates the points
+	static constexpr int DENSITY_THRESHOLD = 50000;
+
 	ScatterPlot();
 	void setValues(const QList< std::pair<double,double> >& values, const QList<QString>& colors = QList<QString>())
 	{
@@ -51,7 +91,18 @@ public:
 	{
 		color_legend_.insert(color, desc);
 	}
+	//sets the rendering mode for large point sets and the grid size used for decimation/heatmap (default: AUTO, 300x200 cells)
+	void setDensityMode(DensityMode mode, int grid_width = 300, int grid_height = 200)
+	{
+		density_mode_ = mode;
+		grid_width_ = grid_width;
+		grid_height_ = grid_height;
+	}
+	//aggregates the points into a grid over the plot range, in parallel for large point sets (one local grid per thread). Points outside the plot range are skipped. If @p threads is 0, the ideal thread count is used.
+	DensityGrid densityGrid(int width, int height, int threads = 0);
 	void store(QString filename);
+	//returns a renderer for the plot, which draws it without QtCharts (see PlotRenderer)
+	PlotRenderer renderer();
 
 protected:
 	//variables to store the plot data
@@ -70,6 +121,22 @@ protected:
 	bool yrange_set_;
 	bool xrange_set_;
 	bool yscale_log_;	
+	DensityMode density_mode_;
+	int grid_width_;
+	int grid_height_;
+
+	//determines the x/y range from the points, if not set
+	void determineRanges();
+	//returns the density mode used for plotting (resolves AUTO)
+	DensityMode plotDensityMode() const;
+	//determines the points to draw per color (in order of first occurrence) for POINTS and DECIMATED mode
+	void pointsByColor(DensityMode mode, QList<QString>& colors, QList<QVector<QPointF>>& points);
+	//returns the centers of non-empty grid cells per heatmap level (log scale of the point count)
+	static QList<QVector<QPointF>> heatmapLevels(const DensityGrid& grid, int levels);
+	//returns the color of a heatmap level
+	static QColor heatmapColor(int level, int levels);
+	//returns the heatmap marker size in pixels
+	static double heatmapMarkerSize(const DensityGrid& grid);
 };
 
 #endif // SCATTERPLOT_H
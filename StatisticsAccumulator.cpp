@@ -0,0 +1,213 @@
+#include "StatisticsAccumulator.h"
+#include "Exceptions.h"
+#include <algorithm>
+
+StatisticsAccumulator::StatisticsAccumulator()
+{
+	clear();
+}
+
+void StatisticsAccumulator::add(const double* data, qint64 size)
+{
+	for (qint64 i=0; i<size; ++i)
+	{
+		add(data[i]);
+	}
+}
+
+void StatisticsAccumulator::merge(const StatisticsAccumulator& other)
+{
+	invalid_ += other.invalid_;
+	if (other.count_==0) return;
+	if (count_==0)
+	{
+		qint64 invalid = invalid_;
+		*this = other;
+		invalid_ = invalid;
+		return;
+	}
+
+	const double n_a = count_;
+	const double n_b = other.count_;
+	const double n = n_a + n_b;
+	const double delta = other.mean_ - mean_;
+	mean_ += delta * n_b / n;
+	m2_ += other.m2_ + delta * delta * n_a * n_b / n;
+	count_ += other.count_;
+	min_ = std::min(min_, other.min_);
+	max_ = std::max(max_, other.max_);
+}
+
+StatisticsAccumulator StatisticsAccumulator::fromMoments(qint64 count, double mean, double m2, double min, double max)
+{
+	StatisticsAccumulator output;
+	output.count_ = count;
+	output.mean_ = mean;
+	output.m2_ = m2;
+	output.min_ = min;
+	output.max_ = max;
+	return output;
+}
+
+void StatisticsAccumulator::clear()
+{
+	count_ = 0;
+	invalid_ = 0;
+	mean_ = 0.0;
+	m2_ = 0.0;
+	min_ = std::numeric_limits<double>::max();
+	max_ = -std::numeric_limits<double>::max();
+}
+
+double StatisticsAccumulator::mean() const
+{
+	if (count_==0) THROW(StatisticsException, "Cannot calculate mean on empty data!");
+
+	return mean_;
+}
+
+double StatisticsAccumulator::sum() const
+{
+	return mean_ * count_;
+}
+
+double StatisticsAccumulator::variance() const
+{
+	if (count_==0) THROW(StatisticsException, "Cannot calculate variance on empty data!");
+
+	return m2_ / count_;
+}
+
+double StatisticsAccumulator::sampleVariance() const
+{
+	if (count_<2) THROW(StatisticsException, "Cannot calculate sample variance on less than two values!");
+
+	return m2_ / (count_ - 1);
+}
+
+double StatisticsAccumulator::stdev() const
+{
+	return std::sqrt(variance());
+}
+
+double StatisticsAccumulator::min() const
+{
+	if (count_==0) THROW(StatisticsException, "Cannot calculate minimum on empty data!");
+
+	return min_;
+}
+
+double StatisticsAccumulator::max() const
+{
+	if (count_==0) THROW(StatisticsException, "Cannot calculate maximum on empty data!");
+
+	return max_;
+}
+
+CovarianceAccumulator::CovarianceAccumulator()
+{
+	clear();
+}
+
+void CovarianceAccumulator::add(const QVector<double>& x, const QVector<double>& y)
+{
+	if (x.count()!=y.count()) THROW(StatisticsException, "Cannot accumulate data arrays with different length!");
+
+	for (int i=0; i<x.count(); ++i)
+	{
+		add(x[i], y[i]);
+	}
+}
+
+void CovarianceAccumulator::merge(const CovarianceAccumulator& other)
+{
+	invalid_ += other.invalid_;
+	if (other.count_==0) return;
+	if (count_==0)
+	{
+		qint64 invalid = invalid_;
+		*this = other;
+		invalid_ = invalid;
+		return;
+	}
+
+	const double n_a = count_;
+	const double n_b = other.count_;
+	const double n = n_a + n_b;
+	const double dx = other.mean_x_ - mean_x_;
+	const double dy = other.mean_y_ - mean_y_;
+	mean_x_ += dx * n_b / n;
+	mean_y_ += dy * n_b / n;
+	m2_x_ += other.m2_x_ + dx * dx * n_a * n_b / n;
+	m2_y_ += other.m2_y_ + dy * dy * n_a * n_b / n;
+	c_ += other.c_ + dx * dy * n_a * n_b / n;
+	count_ += other.count_;
+}
+
+CovarianceAccumulator CovarianceAccumulator::fromMoments(qint64 count, double mean_x, double mean_y, double m2_x, double m2_y, double c)
+{
+	CovarianceAccumulator output;
+	output.count_ = count;
+	output.mean_x_ = mean_x;
+	output.mean_y_ = mean_y;
+	output.m2_x_ = m2_x;
+	output.m2_y_ = m2_y;
+	output.c_ = c;
+	return output;
+}
+
+void CovarianceAccumulator::clear()
+{
+	count_ = 0;
+	invalid_ = 0;
+	mean_x_ = 0.0;
+	mean_y_ = 0.0;
+	m2_x_ = 0.0;
+	m2_y_ = 0.0;
+	c_ = 0.0;
+}
+
+double CovarianceAccumulator::meanX() const
+{
+	checkNotEmpty("mean");
+	return mean_x_;
+}
+
+double CovarianceAccumulator::meanY() const
+{
+	checkNotEmpty("mean");
+	return mean_y_;
+}
+
+double CovarianceAccumulator::covariance() const
+{
+	checkNotEmpty("covariance");
+	return c_ / count_;
+}
+
+double CovarianceAccumulator::sampleCovariance() const
+{
+	if (count_<2) THROW(StatisticsException, "Cannot calculate sample covariance on less than two pairs!");
+
+	return c_ / (count_ - 1);
+}
+
+double CovarianceAccumulator::correlation() const
+{
+	checkNotEmpty("correlation");
+	return c_ / std::sqrt(m2_x_) / std::sqrt(m2_y_);
+}
+
+QPair<double, double> CovarianceAccumulator::linearRegression() const
+{
+	checkNotEmpty("linear regression");
+
+	double slope = c_ / m2_x_;
+	double offset = mean_y_ - slope * mean_x_;
+	return qMakePair(offset, slope);
+}
+
+void CovarianceAccumulator::checkNotEmpty(QString what) const
+{
+	if (count_==0) THROW(StatisticsException, "Cannot calculate " + what + " on empty data!");
+}
@@ -0,0 +1,162 @@
+#ifndef STATISTICSACCUMULATOR_H
+#define STATISTICSACCUMULATOR_H
+
+#include "cppCORE_global.h"
+#include <QVector>
+#include <QPair>
+#include <cmath>
+#include <limits>
+
+/**
+  @brief Online accumulator for count, mean, variance, minimum and maximum of a data stream.
+
+  Uses Welford's algorithm, i.e. the values do not need to be stored and the result is numerically stable even for billions of values.
+  Accumulators of several threads or data chunks can be combined using merge().
+  Invalid values (NaN, infinity) are not used, but counted separately.
+*/
+class CPPCORESHARED_EXPORT StatisticsAccumulator
+{
+public:
+	///Default constructor.
+	StatisticsAccumulator();
+
+	///Adds a value.
+	void add(double value)
+	{
+		if (!std::isfinite(value))
+		{
+			++invalid_;
+			return;
+		}
+
+		++count_;
+		double delta = value - mean_;
+		mean_ += delta / count_;
+		m2_ += delta * (value - mean_);
+		if (value<min_) min_ = value;
+		if (value>max_) max_ = value;
+	}
+	///Adds all values of an array.
+	void add(const double* data, qint64 size);
+	///Adds all values of an array.
+	void add(const QVector<double>& data)
+	{
+		add(data.constData(), data.count());
+	}
+	///Merges the values of another accumulator into this accumulator (pairwise update formula of Chan et al.).
+	void merge(const StatisticsAccumulator& other);
+	///Creates an accumulator from pre-calculated moments, e.g. of a data chunk. @p m2 is the sum of squared deviations from the mean.
+	static StatisticsAccumulator fromMoments(qint64 count, double mean, double m2, double min = std::numeric_limits<double>::max(), double max = -std::numeric_limits<double>::max());
+	///Resets the accumulator.
+	void clear();
+
+	///Returns the number of valid values.
+	qint64 count() const
+	{
+		return count_;
+	}
+	///Returns the number of invalid values, which were ignored.
+	qint64 invalidCount() const
+	{
+		return invalid_;
+	}
+	///Returns the mean.
+	double mean() const;
+	///Returns the sum.
+	double sum() const;
+	///Returns the population variance (divided by n like BasicStatistics::stdev).
+	double variance() const;
+	///Returns the sample variance (divided by n-1).
+	double sampleVariance() const;
+	///Returns the population standard deviation (like BasicStatistics::stdev).
+	double stdev() const;
+	///Returns the minimum.
+	double min() const;
+	///Returns the maximum.
+	double max() const;
+
+protected:
+	qint64 count_;
+	qint64 invalid_;
+	double mean_;
+	double m2_;
+	double min_;
+	double max_;
+};
+
+/**
+  @brief Online accumulator for the covariance, correlation and linear regression of paired data streams.
+
+  Uses the bivariate version of Welford's algorithm. Accumulators of several threads or data chunks can be combined using merge().
+  Pairs with an invalid value (NaN, infinity) are not used, but counted separately.
+*/
+class CPPCORESHARED_EXPORT CovarianceAccumulator
+{
+public:
+	///Default constructor.
+	CovarianceAccumulator();
+
+	///Adds a pair of values.
+	void add(double x, double y)
+	{
+		if (!std::isfinite(x) || !std::isfinite(y))
+		{
+			++invalid_;
+			return;
+		}
+
+		++count_;
+		double dx = x - mean_x_;
+		double dy = y - mean_y_;
+		mean_x_ += dx / count_;
+		mean_y_ += dy / count_;
+		m2_x_ += dx * (x - mean_x_);
+		m2_y_ += dy * (y - mean_y_);
+		c_ += dx * (y - mean_y_);
+	}
+	///Adds all pairs of two arrays of equal length.
+	void add(const QVector<double>& x, const QVector<double>& y);
+	///Merges the pairs of another accumulator into this accumulator.
+	void merge(const CovarianceAccumulator& other);
+	///Creates an accumulator from pre-calculated moments, e.g. of a data chunk. @p m2_x/@p m2_y are the sums of squared deviations from the means, @p c is the sum of the products of the deviations.
+	static CovarianceAccumulator fromMoments(qint64 count, double mean_x, double mean_y, double m2_x, double m2_y, double c);
+	///Resets the accumulator.
+	void clear();
+
+	///Returns the number of valid pairs.
+	qint64 count() const
+	{
+		return count_;
+	}
+	///Returns the number of pairs with invalid values, which were ignored.
+	qint64 invalidCount() const
+	{
+		return invalid_;
+	}
+	///Returns the mean of x.
+	double meanX() const;
+	///Returns the mean of y.
+	double meanY() const;
+	///Returns the population covariance (divided by n).
+	double covariance() const;
+	///Returns the sample covariance (divided by n-1).
+	double sampleCovariance() const;
+	///Returns the Pearson correlation (like BasicStatistics::correlation).
+	double correlation() const;
+	///Returns the offset and slope of a linear regression (like BasicStatistics::linearRegression).
+	QPair<double, double> linearRegression() const;
+
+protected:
+	qint64 count_;
+	qint64 invalid_;
+	double mean_x_;
+	double mean_y_;
+	double m2_x_;
+	double m2_y_;
+	double c_;
+
+	//throws an exception if there is no data
+	void checkNotEmpty(QString what) const;
+};
+
+#endif // STATISTICSACCUMULATOR_H
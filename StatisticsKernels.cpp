@@ -0,0 +1,591 @@
+#include "StatisticsKernels.h"
+#include "Exceptions.h"
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+//SIMD kernels are compiled for x86 with GCC/Clang using target attributes, i.e. no special compiler flags are needed
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CPPCORE_SIMD_X86
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+//Returns if a value is valid (not NaN and not infinity), see BasicStatistics::isValidFloat
+static inline bool isValid(double value)
+{
+	return std::fabs(value)<=std::numeric_limits<double>::max();
+}
+
+//Kahan summation. The compensation is reset when the sum becomes infinite or NaN (inf-inf would be NaN), so infinite values give the same result as plain summation.
+struct KahanSum
+{
+	double sum = 0.0;
+	double c = 0.0;
+
+	void add(double value)
+	{
+		double y = value - c;
+		double t = sum + y;
+		c = isValid(t) ? (t - sum) - y : 0.0;
+		sum = t;
+	}
+};
+
+/*************************************************** scalar ***************************************************/
+
+static double sumScalar(const double* data, qint64 n)
+{
+	KahanSum output;
+	for (qint64 i=0; i<n; ++i)
+	{
+		output.add(data[i]);
+	}
+	return output.sum;
+}
+
+static double sumSquaredDeviationsScalar(const double* data, qint64 n, double mean)
+{
+	KahanSum output;
+	for (qint64 i=0; i<n; ++i)
+	{
+		double d = data[i] - mean;
+		output.add(d * d);
+	}
+	return output.sum;
+}
+
+static double sumProductDeviationsScalar(const double* x, const double* y, qint64 n, double mean_x, double mean_y)
+{
+	KahanSum output;
+	for (qint64 i=0; i<n; ++i)
+	{
+		output.add((x[i] - mean_x) * (y[i] - mean_y));
+	}
+	return output.sum;
+}
+
+static void minMaxScalar(const double* data, qint64 n, double& min, double& max)
+{
+	for (qint64 i=0; i<n; ++i)
+	{
+		if (!isValid(data[i])) continue;
+
+		if (data[i]<min) min = data[i];
+		if (data[i]>max) max = data[i];
+	}
+}
+
+static qint64 validPairSumsScalar(const double* x, const double* y, qint64 n, KahanSum& sum_x, KahanSum& sum_y)
+{
+	qint64 count = 0;
+	for (qint64 i=0; i<n; ++i)
+	{
+		if (!isValid(x[i]) || !isValid(y[i])) continue;
+
+		sum_x.add(x[i]);
+		sum_y.add(y[i]);
+		++count;
+	}
+	return count;
+}
+
+static void regressionSumsScalar(const double* x, const double* y, qint64 n, double mean_x, KahanSum& sum_tt, KahanSum& sum_ty)
+{
+	for (qint64 i=0; i<n; ++i)
+	{
+		if (!isValid(x[i]) || !isValid(y[i])) continue;
+
+		double t = x[i] - mean_x;
+		sum_tt.add(t * t);
+		sum_ty.add(t * y[i]);
+	}
+}
+
+#ifdef CPPCORE_SIMD_X86
+
+/*************************************************** AVX2 ***************************************************/
+
+//returns a mask with all bits set for valid values
+TARGET_AVX2 static inline __m256d validMask(__m256d value)
+{
+	const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+	return _mm256_cmp_pd(_mm256_and_pd(value, abs_mask), _mm256_set1_pd(std::numeric_limits<double>::max()), _CMP_LE_OQ);
+}
+
+//Kahan summation step per lane (compensation is reset for lanes with infinite/NaN sum, see KahanSum)
+TARGET_AVX2 static inline void kahanAdd(__m256d& sum, __m256d& c, __m256d value)
+{
+	__m256d y = _mm256_sub_pd(value, c);
+	__m256d t = _mm256_add_pd(sum, y);
+	c = _mm256_and_pd(_mm256_sub_pd(_mm256_sub_pd(t, sum), y), validMask(t));
+	sum = t;
+}
+
+//combines the lanes of a Kahan sum
+TARGET_AVX2 static inline KahanSum combine(__m256d sum, __m256d c)
+{
+	double sums[4];
+	double comps[4];
+	_mm256_storeu_pd(sums, sum);
+	_mm256_storeu_pd(comps, c);
+
+	KahanSum output;
+	for (int l=0; l<4; ++l)
+	{
+		output.add(sums[l]);
+		output.add(-comps[l]);
+	}
+	return output;
+}
+
+TARGET_AVX2 static double sumAvx2(const double* data, qint64 n)
+{
+	__m256d sum = _mm256_setzero_pd();
+	__m256d c = _mm256_setzero_pd();
+	qint64 i = 0;
+	for (; i+4<=n; i+=4)
+	{
+		kahanAdd(sum, c, _mm256_loadu_pd(data + i));
+	}
+
+	KahanSum output = combine(sum, c);
+	for (; i<n; ++i)
+	{
+		output.add(data[i]);
+	}
+	return output.sum;
+}
+
+TARGET_AVX2 static double sumSquaredDeviationsAvx2(const double* data, qint64 n, double mean)
+{
+	const __m256d m = _mm256_set1_pd(mean);
+	__m256d sum = _mm256_setzero_pd();
+	__m256d c = _mm256_setzero_pd();
+	qint64 i = 0;
+	for (; i+4<=n; i+=4)
+	{
+		__m256d d = _mm256_sub_pd(_mm256_loadu_pd(data + i), m);
+		kahanAdd(sum, c, _mm256_mul_pd(d, d));
+	}
+
+	KahanSum output = combine(sum, c);
+	for (; i<n; ++i)
+	{
+		double d = data[i] - mean;
+		output.add(d * d);
+	}
+	return output.sum;
+}
+
+TARGET_AVX2 static double sumProductDeviationsAvx2(const double* x, const double* y, qint64 n, double mean_x, double mean_y)
+{
+	const __m256d mx = _mm256_set1_pd(mean_x);
+	const __m256d my = _mm256_set1_pd(mean_y);
+	__m256d sum = _mm256_setzero_pd();
+	__m256d c = _mm256_setzero_pd();
+	qint64 i = 0;
+	for (; i+4<=n; i+=4)
+	{
+		__m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), mx);
+		__m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), my);
+		kahanAdd(sum, c, _mm256_mul_pd(dx, dy));
+	}
+
+	KahanSum output = combine(sum, c);
+	for (; i<n; ++i)
+	{
+		output.add((x[i] - mean_x) * (y[i] - mean_y));
+	}
+	return output.sum;
+}
+
+TARGET_AVX2 static void minMaxAvx2(const double* data, qint64 n, double& min, double& max)
+{
+	const __m256d init_min = _mm256_set1_pd(min);
+	const __m256d init_max = _mm256_set1_pd(max);
+	__m256d vmin = init_min;
+	__m256d vmax = init_max;
+	qint64 i = 0;
+	for (; i+4<=n; i+=4)
+	{
+		__m256d v = _mm256_loadu_pd(data + i);
+		__m256d valid = validMask(v);
+		vmin = _mm256_min_pd(vmin, _mm256_blendv_pd(init_min, v, valid));
+		vmax = _mm256_max_pd(vmax, _mm256_blendv_pd(init_max, v, valid));
+	}
+
+	double mins[4];
+	double maxs[4];
+	_mm256_storeu_pd(mins, vmin);
+	_mm256_storeu_pd(maxs, vmax);
+	for (int l=0; l<4; ++l)
+	{
+		if (mins[l]<min) min = mins[l];
+		if (maxs[l]>max) max = maxs[l];
+	}
+	minMaxScalar(data + i, n - i, min, max);
+}
+
+TARGET_AVX2 static qint64 validPairSumsAvx2(const double* x, const double* y, qint64 n, KahanSum& sum_x, KahanSum& sum_y)
+{
+	__m256d sx = _mm256_setzero_pd();
+	__m256d cx = _mm256_setzero_pd();
+	__m256d sy = _mm256_setzero_pd();
+	__m256d cy = _mm256_setzero_pd();
+	__m256i count = _mm256_setzero_si256();
+	qint64 i = 0;
+	for (; i+4<=n; i+=4)
+	{
+		__m256d vx = _mm256_loadu_pd(x + i);
+		__m256d vy = _mm256_loadu_pd(y + i);
+		__m256d valid = _mm256_and_pd(validMask(vx), validMask(vy));
+		kahanAdd(sx, cx, _mm256_and_pd(vx, valid));
+		kahanAdd(sy, cy, _mm256_and_pd(vy, valid));
+		count = _mm256_sub_epi64(count, _mm256_castpd_si256(valid)); //valid lanes are -1
+	}
+
+	sum_x = combine(sx, cx);
+	sum_y = combine(sy, cy);
+	qint64 counts[4];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(counts), count);
+	return counts[0] + counts[1] + counts[2] + counts[3] + validPairSumsScalar(x + i, y + i, n - i, sum_x, sum_y);
+}
+
+TARGET_AVX2 static void regressionSumsAvx2(const double* x, const double* y, qint64 n, double mean_x, KahanSum& sum_tt, KahanSum& sum_ty)
+{
+	const __m256d mx = _mm256_set1_pd(mean_x);
+	__m256d stt = _mm256_setzero_pd();
+	__m256d ctt = _mm256_setzero_pd();
+	__m256d sty = _mm256_setzero_pd();
+	__m256d cty = _mm256_setzero_pd();
+	qint64 i = 0;
+	for (; i+4<=n; i+=4)
+	{
+		__m256d vx = _mm256_loadu_pd(x + i);
+		__m256d vy = _mm256_loadu_pd(y + i);
+		__m256d valid = _mm256_and_pd(validMask(vx), validMask(vy));
+		__m256d t = _mm256_and_pd(_mm256_sub_pd(vx, mx), valid);
+		kahanAdd(stt, ctt, _mm256_mul_pd(t, t));
+		kahanAdd(sty, cty, _mm256_mul_pd(t, _mm256_and_pd(vy, valid)));
+	}
+
+	sum_tt = combine(stt, ctt);
+	sum_ty = combine(sty, cty);
+	regressionSumsScalar(x + i, y + i, n - i, mean_x, sum_tt, sum_ty);
+}
+
+/*************************************************** AVX-512 ***************************************************/
+
+//returns a mask with bits set for valid values
+TARGET_AVX512 static inline __mmask8 validMask(__m512d value)
+{
+	return _mm512_cmp_pd_mask(_mm512_abs_pd(value), _mm512_set1_pd(std::numeric_limits<double>::max()), _CMP_LE_OQ);
+}
+
+//Kahan summation step per lane (compensation is reset for lanes with infinite/NaN sum, see KahanSum)
+TARGET_AVX512 static inline void kahanAdd(__m512d& sum, __m512d& c, __m512d value)
+{
+	__m512d y = _mm512_sub_pd(value, c);
+	__m512d t = _mm512_add_pd(sum, y);
+	c = _mm512_maskz_mov_pd(validMask(t), _mm512_sub_pd(_mm512_sub_pd(t, sum), y));
+	sum = t;
+}
+
+//combines the lanes of a Kahan sum
+TARGET_AVX512 static inline KahanSum combine(__m512d sum, __m512d c)
+{
+	double sums[8];
+	double comps[8];
+	_mm512_storeu_pd(sums, sum);
+	_mm512_storeu_pd(comps, c);
+
+	KahanSum output;
+	for (int l=0; l<8; ++l)
+	{
+		output.add(sums[l]);
+		output.add(-comps[l]);
+	}
+	return output;
+}
+
+//returns the mask of the lanes in the remaining range (the last iteration loads a partial vector with masked loads instead of a scalar loop)
+static inline __mmask8 rangeMask(qint64 remaining)
+{
+	return remaining>=8 ? 0xFF : static_cast<__mmask8>((1u << remaining) - 1);
+}
+
+TARGET_AVX512 static double sumAvx512(const double* data, qint64 n)
+{
+	__m512d sum = _mm512_setzero_pd();
+	__m512d c = _mm512_setzero_pd();
+	for (qint64 i=0; i<n; i+=8)
+	{
+		kahanAdd(sum, c, _mm512_maskz_loadu_pd(rangeMask(n-i), data + i));
+	}
+	return combine(sum, c).sum;
+}
+
+TARGET_AVX512 static double sumSquaredDeviationsAvx512(const double* data, qint64 n, double mean)
+{
+	const __m512d m = _mm512_set1_pd(mean);
+	__m512d sum = _mm512_setzero_pd();
+	__m512d c = _mm512_setzero_pd();
+	for (qint64 i=0; i<n; i+=8)
+	{
+		__mmask8 range = rangeMask(n-i);
+		__m512d d = _mm512_maskz_sub_pd(range, _mm512_maskz_loadu_pd(range, data + i), m);
+		kahanAdd(sum, c, _mm512_mul_pd(d, d));
+	}
+	return combine(sum, c).sum;
+}
+
+TARGET_AVX512 static double sumProductDeviationsAvx512(const double* x, const double* y, qint64 n, double mean_x, double mean_y)
+{
+	const __m512d mx = _mm512_set1_pd(mean_x);
+	const __m512d my = _mm512_set1_pd(mean_y);
+	__m512d sum = _mm512_setzero_pd();
+	__m512d c = _mm512_setzero_pd();
+	for (qint64 i=0; i<n; i+=8)
+	{
+		__mmask8 range = rangeMask(n-i);
+		__m512d dx = _mm512_maskz_sub_pd(range, _mm512_maskz_loadu_pd(range, x + i), mx);
+		__m512d dy = _mm512_maskz_sub_pd(range, _mm512_maskz_loadu_pd(range, y + i), my);
+		kahanAdd(sum, c, _mm512_mul_pd(dx, dy));
+	}
+	return combine(sum, c).sum;
+}
+
+TARGET_AVX512 static void minMaxAvx512(const double* data, qint64 n, double& min, double& max)
+{
+	__m512d vmin = _mm512_set1_pd(min);
+	__m512d vmax = _mm512_set1_pd(max);
+	for (qint64 i=0; i<n; i+=8)
+	{
+		__mmask8 range = rangeMask(n-i);
+		__m512d v = _mm512_maskz_loadu_pd(range, data + i);
+		__mmask8 valid = range & validMask(v);
+		vmin = _mm512_mask_min_pd(vmin, valid, vmin, v);
+		vmax = _mm512_mask_max_pd(vmax, valid, vmax, v);
+	}
+	min = std::min(min, _mm512_reduce_min_pd(vmin));
+	max = std::max(max, _mm512_reduce_max_pd(vmax));
+}
+
+TARGET_AVX512 static qint64 validPairSumsAvx512(const double* x, const double* y, qint64 n, KahanSum& sum_x, KahanSum& sum_y)
+{
+	__m512d sx = _mm512_setzero_pd();
+	__m512d cx = _mm512_setzero_pd();
+	__m512d sy = _mm512_setzero_pd();
+	__m512d cy = _mm512_setzero_pd();
+	qint64 count = 0;
+	for (qint64 i=0; i<n; i+=8)
+	{
+		__mmask8 range = rangeMask(n-i);
+		__m512d vx = _mm512_maskz_loadu_pd(range, x + i);
+		__m512d vy = _mm512_maskz_loadu_pd(range, y + i);
+		__mmask8 valid = range & validMask(vx) & validMask(vy);
+		kahanAdd(sx, cx, _mm512_maskz_mov_pd(valid, vx));
+		kahanAdd(sy, cy, _mm512_maskz_mov_pd(valid, vy));
+		count += __builtin_popcount(valid);
+	}
+
+	sum_x = combine(sx, cx);
+	sum_y = combine(sy, cy);
+	return count;
+}
+
+TARGET_AVX512 static void regressionSumsAvx512(const double* x, const double* y, qint64 n, double mean_x, KahanSum& sum_tt, KahanSum& sum_ty)
+{
+	const __m512d mx = _mm512_set1_pd(mean_x);
+	__m512d stt = _mm512_setzero_pd();
+	__m512d ctt = _mm512_setzero_pd();
+	__m512d sty = _mm512_setzero_pd();
+	__m512d cty = _mm512_setzero_pd();
+	for (qint64 i=0; i<n; i+=8)
+	{
+		__mmask8 range = rangeMask(n-i);
+		__m512d vx = _mm512_maskz_loadu_pd(range, x + i);
+		__m512d vy = _mm512_maskz_loadu_pd(range, y + i);
+		__mmask8 valid = range & validMask(vx) & validMask(vy);
+		__m512d t = _mm512_maskz_sub_pd(valid, vx, mx);
+		kahanAdd(stt, ctt, _mm512_mul_pd(t, t));
+		kahanAdd(sty, cty, _mm512_mul_pd(t, _mm512_maskz_mov_pd(valid, vy)));
+	}
+
+	sum_tt = combine(stt, ctt);
+	sum_ty = combine(sty, cty);
+}
+
+#endif
+
+/*************************************************** dispatch ***************************************************/
+
+//returns the best instruction set supported by the CPU
+static StatisticsKernels::InstructionSet bestInstructionSet()
+{
+	if (StatisticsKernels::isSupported(StatisticsKernels::InstructionSet::AVX512)) return StatisticsKernels::InstructionSet::AVX512;
+	if (StatisticsKernels::isSupported(StatisticsKernels::InstructionSet::AVX2)) return StatisticsKernels::InstructionSet::AVX2;
+	return StatisticsKernels::InstructionSet::SCALAR;
+}
+
+//returns the instruction set in use (detected once)
+static std::atomic<int>& currentInstructionSet()
+{
+	static std::atomic<int> set(static_cast<int>(bestInstructionSet()));
+	return set;
+}
+
+StatisticsKernels::InstructionSet StatisticsKernels::instructionSet()
+{
+	return static_cast<InstructionSet>(currentInstructionSet().load(std::memory_order_relaxed));
+}
+
+void StatisticsKernels::setInstructionSet(InstructionSet set)
+{
+	if (!isSupported(set)) THROW(ArgumentException, "Instruction set " + name(set) + " is not supported by the CPU!");
+
+	currentInstructionSet().store(static_cast<int>(set), std::memory_order_relaxed);
+}
+
+bool StatisticsKernels::isSupported(InstructionSet set)
+{
+	switch(set)
+	{
+#ifdef CPPCORE_SIMD_X86
+		case InstructionSet::AVX512:
+			return __builtin_cpu_supports("avx512f");
+		case InstructionSet::AVX2:
+			return __builtin_cpu_supports("avx2");
+#endif
+		case InstructionSet::SCALAR:
+			return true;
+		default:
+			return false;
+	}
+}
+
+QString StatisticsKernels::name(InstructionSet set)
+{
+	switch(set)
+	{
+		case InstructionSet::AVX512:
+			return "AVX-512";
+		case InstructionSet::AVX2:
+			return "AVX2";
+		default:
+			return "scalar";
+	}
+}
+
+double StatisticsKernels::sum(const double* data, qint64 n)
+{
+	switch(instructionSet())
+	{
+#ifdef CPPCORE_SIMD_X86
+		case InstructionSet::AVX512:
+			return sumAvx512(data, n);
+		case InstructionSet::AVX2:
+			return sumAvx2(data, n);
+#endif
+		default:
+			return sumScalar(data, n);
+	}
+}
+
+double StatisticsKernels::sumSquaredDeviations(const double* data, qint64 n, double mean)
+{
+	switch(instructionSet())
+	{
+#ifdef CPPCORE_SIMD_X86
+		case InstructionSet::AVX512:
+			return sumSquaredDeviationsAvx512(data, n, mean);
+		case InstructionSet::AVX2:
+			return sumSquaredDeviationsAvx2(data, n, mean);
+#endif
+		default:
+			return sumSquaredDeviationsScalar(data, n, mean);
+	}
+}
+
+double StatisticsKernels::sumProductDeviations(const double* x, const double* y, qint64 n, double mean_x, double mean_y)
+{
+	switch(instructionSet())
+	{
+#ifdef CPPCORE_SIMD_X86
+		case InstructionSet::AVX512:
+			return sumProductDeviationsAvx512(x, y, n, mean_x, mean_y);
+		case InstructionSet::AVX2:
+			return sumProductDeviationsAvx2(x, y, n, mean_x, mean_y);
+#endif
+		default:
+			return sumProductDeviationsScalar(x, y, n, mean_x, mean_y);
+	}
+}
+
+void StatisticsKernels::minMax(const double* data, qint64 n, double& min, double& max)
+{
+	min = std::numeric_limits<double>::max();
+	max = -std::numeric_limits<double>::max();
+
+	switch(instructionSet())
+	{
+#ifdef CPPCORE_SIMD_X86
+		case InstructionSet::AVX512:
+			minMaxAvx512(data, n, min, max);
+			break;
+		case InstructionSet::AVX2:
+			minMaxAvx2(data, n, min, max);
+			break;
+#endif
+		default:
+			minMaxScalar(data, n, min, max);
+	}
+}
+
+qint64 StatisticsKernels::validPairSums(const double* x, const double* y, qint64 n, double& sum_x, double& sum_y)
+{
+	KahanSum sx;
+	KahanSum sy;
+	qint64 count = 0;
+	switch(instructionSet())
+	{
+#ifdef CPPCORE_SIMD_X86
+		case InstructionSet::AVX512:
+			count = validPairSumsAvx512(x, y, n, sx, sy);
+			break;
+		case InstructionSet::AVX2:
+			count = validPairSumsAvx2(x, y, n, sx, sy);
+			break;
+#endif
+		default:
+			count = validPairSumsScalar(x, y, n, sx, sy);
+	}
+
+	sum_x = sx.sum;
+	sum_y = sy.sum;
+	return count;
+}
+
+void StatisticsKernels::regressionSums(const double* x, const double* y, qint64 n, double mean_x, double& sum_tt, double& sum_ty)
+{
+	KahanSum stt;
+	KahanSum sty;
+	switch(instructionSet())
+	{
+#ifdef CPPCORE_SIMD_X86
+		case InstructionSet::AVX512:
+			regressionSumsAvx512(x, y, n, mean_x, stt, sty);
+			break;
+		case InstructionSet::AVX2:
+			regressionSumsAvx2(x, y, n, mean_x, stt, sty);
+			break;
+#endif
+		default:
+			regressionSumsScalar(x, y, n, mean_x, stt, sty);
+	}
+
+	sum_tt = stt.sum;
+	sum_ty = sty.sum;
+}
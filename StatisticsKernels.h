@@ -0,0 +1,48 @@
+#ifndef STATISTICSKERNELS_H
+#define STATISTICSKERNELS_H
+
+#include "cppCORE_global.h"
+#include <QString>
+
+/**
+  @brief Vectorized reduction kernels used by BasicStatistics.
+
+  The best implementation for the CPU (AVX-512, AVX2 or scalar) is selected at runtime, so the library can be compiled for generic x86-64 targets.
+  Sums are calculated with Kahan compensation (per SIMD lane), which makes them more accurate than plain summation for large arrays.
+  Kernels that skip invalid values (NaN, infinity) use masks instead of branches.
+*/
+class CPPCORESHARED_EXPORT StatisticsKernels
+{
+public:
+	///Instruction set of the kernels.
+	enum class InstructionSet
+	{
+		SCALAR,
+		AVX2,
+		AVX512
+	};
+
+	///Returns the instruction set used by the kernels (best supported by the CPU unless set explicitly).
+	static InstructionSet instructionSet();
+	///Sets the instruction set used by the kernels, e.g. for comparing results. Throws an exception if the CPU does not support it.
+	static void setInstructionSet(InstructionSet set);
+	///Returns if the CPU supports an instruction set.
+	static bool isSupported(InstructionSet set);
+	///Returns the name of an instruction set.
+	static QString name(InstructionSet set);
+
+	///Returns the sum of the values.
+	static double sum(const double* data, qint64 n);
+	///Returns the sum of the squared deviations from @p mean.
+	static double sumSquaredDeviations(const double* data, qint64 n, double mean);
+	///Returns the sum of the products of the deviations of x and y from their means.
+	static double sumProductDeviations(const double* x, const double* y, qint64 n, double mean_x, double mean_y);
+	///Determines minimum and maximum of the valid values. If there are no valid values, @p min is the largest and @p max the lowest double value.
+	static void minMax(const double* data, qint64 n, double& min, double& max);
+	///Calculates the sums of x and y over the pairs in which both values are valid. Returns the number of these pairs.
+	static qint64 validPairSums(const double* x, const double* y, qint64 n, double& sum_x, double& sum_y);
+	///Calculates the sums of t*t and t*y with t=x-mean_x over the pairs in which both values are valid.
+	static void regressionSums(const double* x, const double* y, qint64 n, double mean_x, double& sum_tt, double& sum_ty);
+};
+
+#endif // STATISTICSKERNELS_H
@@ -0,0 +1,353 @@
+#include "TSVFileIndex.h"
+#include "Exceptions.h"
+#include "Helper.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSet>
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+//Reads lines of a plain or BGZF file together with the offset of the line start
+class TSVLineOffsetReader
+{
+public:
+	TSVLineOffsetReader(QString filename, bool bgzf)
+		: filename_(filename)
+		, file_(filename)
+		, bgzf_(bgzf)
+	{
+		if (!file_.open(QFile::ReadOnly)) THROW(FileAccessException, "Could not open file '" + filename + "' for reading!");
+	}
+
+	//Reads the next line (including line ending). Returns false if the end of the file is reached.
+	bool readLine(QByteArray& line, qint64& offset)
+	{
+		if (!bgzf_)
+		{
+			if (file_.atEnd()) return false;
+			offset = file_.pos();
+			line = file_.readLine();
+			return true;
+		}
+
+		line.clear();
+		bool started = false;
+		while (true)
+		{
+			if (block_pos_>=block_.size())
+			{
+				if (!loadNextBlock()) return started;
+				continue;
+			}
+
+			if (!started)
+			{
+				offset = (block_offset_ << 16) | block_pos_;
+				started = true;
+			}
+
+			int newline_index = block_.indexOf('\n', block_pos_);
+			if (newline_index==-1)
+			{
+				line.append(block_.constData() + block_pos_, block_.size() - block_pos_);
+				block_pos_ = block_.size();
+			}
+			else
+			{
+				line.append(block_.constData() + block_pos_, newline_index - block_pos_ + 1);
+				block_pos_ = newline_index + 1;
+				return true;
+			}
+		}
+	}
+
+private:
+	QString filename_;
+	QFile file_;
+	bool bgzf_;
+	qint64 block_offset_ = 0; //compressed offset of the current block
+	QByteArray block_; //decompressed data of the current block
+	int block_pos_ = 0;
+
+	//Loads and decompresses the next BGZF block. Returns false if the end of the file is reached.
+	bool loadNextBlock()
+	{
+		block_offset_ = file_.pos();
+		QByteArray header = file_.read(12);
+		if (header.isEmpty()) return false;
+
+		const uchar* data = reinterpret_cast<const uchar*>(header.constData());
+		if (header.size()<12 || data[0]!=0x1f || data[1]!=0x8b || (data[3] & 4)==0) THROW(FileParseException, "Invalid BGZF block header at offset " + QString::number(block_offset_) + " in file '" + filename_ + "'!");
+
+		//determine block size from 'BC' extra subfield
+		int xlen = data[10] | (data[11] << 8);
+		QByteArray extra = file_.read(xlen);
+		int block_size = -1;
+		for (int i=0; i+4<=extra.size(); )
+		{
+			const uchar* sub = reinterpret_cast<const uchar*>(extra.constData()) + i;
+			int slen = sub[2] | (sub[3] << 8);
+			if (sub[0]=='B' && sub[1]=='C' && slen==2 && i+6<=extra.size())
+			{
+				block_size = (sub[4] | (sub[5] << 8)) + 1;
+			}
+			i += 4 + slen;
+		}
+		if (block_size==-1) THROW(FileParseException, "BGZF block at offset " + QString::number(block_offset_) + " in file '" + filename_ + "' has no block size field!");
+
+		//read compressed data and footer
+		QByteArray rest = file_.read(block_size - 12 - xlen);
+		if (rest.size()!=block_size - 12 - xlen || rest.size()<8) THROW(FileParseException, "Truncated BGZF block at offset " + QString::number(block_offset_) + " in file '" + filename_ + "'!");
+		const uchar* footer = reinterpret_cast<const uchar*>(rest.constData()) + rest.size() - 4;
+		quint32 uncompressed_size = footer[0] | (footer[1] << 8) | (footer[2] << 16) | (quint32(footer[3]) << 24);
+
+		//decompress (raw deflate data)
+		block_.resize(uncompressed_size);
+		block_pos_ = 0;
+		if (uncompressed_size==0) return true;
+
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		if (inflateInit2(&stream, -MAX_WBITS)!=Z_OK) THROW(ProgrammingException, "inflateInit2 failed!");
+		stream.next_in = reinterpret_cast<Bytef*>(rest.data());
+		stream.avail_in = rest.size() - 8;
+		stream.next_out = reinterpret_cast<Bytef*>(block_.data());
+		stream.avail_out = uncompressed_size;
+		int result = inflate(&stream, Z_FINISH);
+		inflateEnd(&stream);
+		if (result!=Z_STREAM_END) THROW(FileParseException, "Could not decompress BGZF block at offset " + QString::number(block_offset_) + " in file '" + filename_ + "'!");
+
+		return true;
+	}
+};
+
+TSVFileIndex::TSVFileIndex()
+	: bgzf_(false)
+	, source_size_(-1)
+	, source_modified_(-1)
+	, lines_per_checkpoint_(0)
+	, row_count_(0)
+	, chr_col_(-1)
+	, start_col_(-1)
+	, end_col_(-1)
+{
+}
+
+TSVFileIndex TSVFileIndex::build(QString filename, int lines_per_checkpoint, int chr_col, int start_col, int end_col, char separator, char comment)
+{
+	if (Helper::isHttpUrl(filename)) THROW(ArgumentException, "Cannot create index for remote file '" + filename + "'!");
+	if (lines_per_checkpoint<1) THROW(ArgumentException, "Invalid number of lines per checkpoint: " + QString::number(lines_per_checkpoint));
+	if (chr_col!=-1 && (start_col<0 || end_col<0)) THROW(ArgumentException, "Start and end column are required for the interval index of '" + filename + "'!");
+
+	TSVFileIndex index;
+	index.bgzf_ = isBgzfFile(filename);
+	QFileInfo info(filename);
+	index.source_size_ = info.size();
+	index.source_modified_ = info.lastModified().toSecsSinceEpoch();
+	index.lines_per_checkpoint_ = lines_per_checkpoint;
+	index.chr_col_ = chr_col;
+	index.start_col_ = start_col;
+	index.end_col_ = end_col;
+
+	//check compression
+	if (!index.bgzf_)
+	{
+		QFile file(filename);
+		if (!file.open(QFile::ReadOnly)) THROW(FileAccessException, "Could not open file '" + filename + "' for reading!");
+		QByteArray magic = file.peek(2);
+		if (magic.size()==2 && uchar(magic[0])==0x1f && uchar(magic[1])==0x8b) THROW(NotImplementedException, "Cannot create index for GZ file '" + filename + "'. Only BGZF-compressed files can be indexed - use 'bgzip' for compression!");
+	}
+
+	const QByteArray double_comment(2, comment);
+	int max_col = std::max(chr_col, std::max(start_col, end_col));
+	QByteArray last_chr;
+	int last_start = -1;
+	QSet<QByteArray> chrs_done;
+
+	TSVLineOffsetReader reader(filename, index.bgzf_);
+	QByteArray line;
+	qint64 offset = 0;
+	qint64 line_index = -1;
+	bool in_header = true;
+	while (reader.readLine(line, offset))
+	{
+		++line_index;
+
+		//skip header and comment lines
+		if (line.startsWith(double_comment)) continue;
+		if (in_header && line.startsWith(comment)) continue;
+		in_header = false;
+
+		//line index
+		if (index.row_count_ % lines_per_checkpoint == 0)
+		{
+			index.checkpoints_ << Checkpoint{index.row_count_, line_index, offset};
+		}
+		++index.row_count_;
+
+		//interval index
+		if (chr_col==-1) continue;
+		while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
+		if (line.isEmpty()) continue;
+		QByteArrayList parts = line.split(separator);
+		if (parts.count()<=max_col) THROW(FileParseException, "Line " + QString::number(line_index+1) + " of '" + filename + "' has only " + QString::number(parts.count()) + " columns: " + line);
+
+		const QByteArray& chr = parts[chr_col];
+		int start = Helper::toInt(parts[start_col], "start position", line);
+		int end = Helper::toInt(parts[end_col], "end position", line);
+		if (chr!=last_chr)
+		{
+			if (chrs_done.contains(chr)) THROW(FileParseException, "File '" + filename + "' is not sorted by chromosome: '" + chr + "' occurs in several blocks!");
+			chrs_done << chr;
+			last_chr = chr;
+			last_start = -1;
+		}
+		if (start<last_start) THROW(FileParseException, "File '" + filename + "' is not sorted by start position in line " + QString::number(line_index+1) + ": " + line);
+		last_start = start;
+
+		//store the first (i.e. smallest) offset of lines overlapping each window
+		QVector<qint64>& windows = index.windows_[chr];
+		int window_end = std::max(start, end) >> WINDOW_SHIFT;
+		if (windows.count()<=window_end) windows.resize(window_end+1, -1);
+		for (int w=start >> WINDOW_SHIFT; w<=window_end; ++w)
+		{
+			if (windows[w]==-1) windows[w] = offset;
+		}
+	}
+
+	return index;
+}
+
+TSVFileIndex TSVFileIndex::load(QString index_file)
+{
+	TSVFileIndex index;
+
+	QSharedPointer<QFile> file = Helper::openFileForReading(index_file);
+	while (!file->atEnd())
+	{
+		QByteArray line = file->readLine().trimmed();
+		if (line.isEmpty()) continue;
+
+		//meta data
+		if (line.startsWith("##"))
+		{
+			QByteArrayList parts = line.mid(2).split('=');
+			if (parts.count()!=2) continue;
+			const QByteArray& key = parts[0];
+			const QByteArray& value = parts[1];
+			if (key=="compression") index.bgzf_ = (value=="bgzf");
+			else if (key=="source_size") index.source_size_ = value.toLongLong();
+			else if (key=="source_modified") index.source_modified_ = value.toLongLong();
+			else if (key=="lines_per_checkpoint") index.lines_per_checkpoint_ = Helper::toInt(value, key);
+			else if (key=="rows") index.row_count_ = value.toLongLong();
+			else if (key=="chr_col") index.chr_col_ = Helper::toInt(value, key);
+			else if (key=="start_col") index.start_col_ = Helper::toInt(value, key);
+			else if (key=="end_col") index.end_col_ = Helper::toInt(value, key);
+			continue;
+		}
+		if (line.startsWith('#')) continue;
+
+		//entries
+		QByteArrayList parts = line.split('\t');
+		if (parts.count()==4 && parts[0]=="L")
+		{
+			index.checkpoints_ << Checkpoint{parts[1].toLongLong(), parts[2].toLongLong(), parts[3].toLongLong()};
+		}
+		else if (parts.count()==4 && parts[0]=="W")
+		{
+			QVector<qint64>& windows = index.windows_[parts[1]];
+			int w = Helper::toInt(parts[2], "window", line);
+			if (windows.count()<=w) windows.resize(w+1, -1);
+			windows[w] = parts[3].toLongLong();
+		}
+		else
+		{
+			THROW(FileParseException, "Invalid line in TSV index file '" + index_file + "': " + line);
+		}
+	}
+
+	if (index.lines_per_checkpoint_<1 || index.source_size_<0) THROW(FileParseException, "TSV index file '" + index_file + "' is missing meta data!");
+
+	return index;
+}
+
+void TSVFileIndex::store(QString index_file) const
+{
+	QSharedPointer<QFile> file = Helper::openFileForWriting(index_file);
+
+	file->write("##compression=" + QByteArray(bgzf_ ? "bgzf" : "none") + "\n");
+	file->write("##source_size=" + QByteArray::number(source_size_) + "\n");
+	file->write("##source_modified=" + QByteArray::number(source_modified_) + "\n");
+	file->write("##lines_per_checkpoint=" + QByteArray::number(lines_per_checkpoint_) + "\n");
+	file->write("##rows=" + QByteArray::number(row_count_) + "\n");
+	file->write("##chr_col=" + QByteArray::number(chr_col_) + "\n");
+	file->write("##start_col=" + QByteArray::number(start_col_) + "\n");
+	file->write("##end_col=" + QByteArray::number(end_col_) + "\n");
+	file->write("#type\tkey\tindex\toffset\n");
+
+	foreach(const Checkpoint& cp, checkpoints_)
+	{
+		file->write("L\t" + QByteArray::number(cp.row) + "\t" + QByteArray::number(cp.line) + "\t" + QByteArray::number(cp.offset) + "\n");
+	}
+
+	for (auto it=windows_.cbegin(); it!=windows_.cend(); ++it)
+	{
+		const QVector<qint64>& windows = it.value();
+		for (int w=0; w<windows.count(); ++w)
+		{
+			if (windows[w]==-1) continue;
+			file->write("W\t" + it.key() + "\t" + QByteArray::number(w) + "\t" + QByteArray::number(windows[w]) + "\n");
+		}
+	}
+}
+
+bool TSVFileIndex::isUpToDate(QString filename) const
+{
+	QFileInfo info(filename);
+	return info.exists() && info.size()==source_size_ && info.lastModified().toSecsSinceEpoch()==source_modified_;
+}
+
+const TSVFileIndex::Checkpoint& TSVFileIndex::checkpoint(qint64 row) const
+{
+	if (row<0 || row>=row_count_ || checkpoints_.isEmpty())
+	{
+		THROW(ArgumentException, "Content line " + QString::number(row) + " out of range (0-" + QString::number(row_count_-1) + ")!");
+	}
+
+	//checkpoints are equidistant
+	qint64 index = std::min(row / lines_per_checkpoint_, static_cast<qint64>(checkpoints_.count()-1));
+	return checkpoints_[index];
+}
+
+qint64 TSVFileIndex::regionOffset(const QByteArray& chr, int start, int end) const
+{
+	if (chr_col_==-1) THROW(ProgrammingException, "TSV file index does not contain an interval index!");
+
+	auto it = windows_.constFind(chr);
+	if (it==windows_.cend()) return -1;
+
+	//a line overlapping the region overlaps one of the windows of the region > the smallest offset of these windows is a safe starting point
+	const QVector<qint64>& windows = it.value();
+	qint64 offset = -1;
+	int w_end = std::min(end >> WINDOW_SHIFT, static_cast<int>(windows.count()-1));
+	for (int w=std::max(0, start >> WINDOW_SHIFT); w<=w_end; ++w)
+	{
+		if (windows[w]!=-1 && (offset==-1 || windows[w]<offset)) offset = windows[w];
+	}
+
+	return offset;
+}
+
+bool TSVFileIndex::isBgzfFile(QString filename)
+{
+	QFile file(filename);
+	if (!file.open(QFile::ReadOnly)) return false;
+
+	//GZ magic bytes, extra field flag and 'BC' subfield
+	QByteArray header = file.read(18);
+	if (header.size()<18) return false;
+	const uchar* data = reinterpret_cast<const uchar*>(header.constData());
+	return data[0]==0x1f && data[1]==0x8b && (data[3] & 4)!=0 && data[12]=='B' && data[13]=='C';
+}
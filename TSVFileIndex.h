@@ -0,0 +1,93 @@
+#ifndef TSVFILEINDEX_H
+#define TSVFILEINDEX_H
+
+#include "cppCORE_global.h"
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+
+/**
+  @brief Sparse index of a plain or BGZF-compressed TSV file, stored as sidecar file next to the TSV file.
+
+  The line index maps every K-th content line to its file offset (byte offset for plain files, virtual offset for BGZF files).
+  The optional interval index maps windows of 16kb on each chromosome to the first line overlapping the window (like the linear index of tabix).
+  It requires that the file is sorted by chromosome and start position.
+*/
+class CPPCORESHARED_EXPORT TSVFileIndex
+{
+public:
+	///Line index entry.
+	struct Checkpoint
+	{
+		///0-based index of the content line (header and comment lines are not counted).
+		qint64 row;
+		///0-based index of the line in the file.
+		qint64 line;
+		///File offset of the line start (virtual offset for BGZF files).
+		qint64 offset;
+	};
+
+	///Default constructor (empty index).
+	TSVFileIndex();
+
+	///Builds the index for a plain or BGZF-compressed TSV file. If @p chr_col is not -1, the interval index is created as well. Column indices are 0-based, @p end_col can be equal to @p start_col for single-position data.
+	static TSVFileIndex build(QString filename, int lines_per_checkpoint = 1000, int chr_col = -1, int start_col = -1, int end_col = -1, char separator = '\t', char comment = '#');
+	///Loads an index from a sidecar file.
+	static TSVFileIndex load(QString index_file);
+	///Stores the index to a sidecar file.
+	void store(QString index_file) const;
+	///Returns the default sidecar file name of a TSV file.
+	static QString indexFileName(QString filename)
+	{
+		return filename + ".lidx";
+	}
+
+	///Returns if the index matches the current state of the given TSV file (size and modification time).
+	bool isUpToDate(QString filename) const;
+	///Returns if the indexed file is BGZF-compressed.
+	bool isBgzf() const
+	{
+		return bgzf_;
+	}
+	///Returns the number of content lines.
+	qint64 rowCount() const
+	{
+		return row_count_;
+	}
+	///Returns the number of content lines between two checkpoints.
+	int linesPerCheckpoint() const
+	{
+		return lines_per_checkpoint_;
+	}
+	///Returns the last checkpoint at or before the given content line.
+	const Checkpoint& checkpoint(qint64 row) const;
+
+	///Returns if the interval index is present for the given columns.
+	bool hasRegionIndex(int chr_col, int start_col, int end_col) const
+	{
+		return chr_col_!=-1 && chr_col_==chr_col && start_col_==start_col && end_col_==end_col;
+	}
+	///Returns the file offset from which all lines overlapping the region can be found, or -1 if no line can overlap. Coordinates are 1-based.
+	qint64 regionOffset(const QByteArray& chr, int start, int end) const;
+
+	///Returns if a file is BGZF-compressed (GZ with BGZF block size field).
+	static bool isBgzfFile(QString filename);
+
+	///Size of the windows of the interval index (2^14=16kb).
+	static constexpr int WINDOW_SHIFT = 14;
+
+protected:
+	bool bgzf_;
+	qint64 source_size_;
+	qint64 source_modified_;
+	int lines_per_checkpoint_;
+	qint64 row_count_;
+	QVector<Checkpoint> checkpoints_;
+	int chr_col_;
+	int start_col_;
+	int end_col_;
+	QHash<QByteArray, QVector<qint64>> windows_; //file offset per window and chromosome (-1 for windows without lines)
+};
+
+#endif // TSVFILEINDEX_H
@@ -0,0 +1,915 @@
+#include "TSVFileJoiner.h"
+#include "TSVFileStream.h"
+#include "Exceptions.h"
+#include "Helper.h"
+#include "Arena.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QFuture>
+#include <QSharedPointer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
+
+//Hash used for the hash tables.
+static quint64 tableHash(QByteArrayView key)
+{
+	return qHashBits(key.data(), key.size(), 0);
+}
+
+//Returns the partition of a key. A different seed than for the hash tables is used, so that keys of one partition are spread evenly over the table.
+static int partitionOf(QByteArrayView key, int partitions)
+{
+	return static_cast<int>(qHashBits(key.data(), key.size(), 0x9e3779b9) % static_cast<quint64>(partitions));
+}
+
+//Open-addressing hash table with linear probing. It maps keys stored in an arena to consecutive indices (in insertion order).
+class TSVKeyTable
+{
+public:
+	TSVKeyTable(Arena& arena)
+		: arena_(arena)
+		, slots_(1024)
+		, mask_(1023)
+	{
+	}
+
+	//Returns the index of the key, or -1 if the key is not contained.
+	int find(QByteArrayView key) const
+	{
+		quint64 hash = tableHash(key);
+		for (quint64 i=hash&mask_; ; i=(i+1)&mask_)
+		{
+			const Slot& slot = slots_[i];
+			if (slot.index==-1) return -1;
+			if (slot.hash==hash && keys_[slot.index]==key) return slot.index;
+		}
+	}
+
+	//Returns the index of the key. If the key is not contained, it is added and @p added is set to true.
+	int insert(QByteArrayView key, bool& added)
+	{
+		if (2*(keys_.count()+1)>slots_.count()) grow();
+
+		quint64 hash = tableHash(key);
+		for (quint64 i=hash&mask_; ; i=(i+1)&mask_)
+		{
+			Slot& slot = slots_[i];
+			if (slot.index==-1)
+			{
+				slot.hash = hash;
+				slot.index = keys_.count();
+				keys_ << arena_.store(key);
+				added = true;
+				return slot.index;
+			}
+			if (slot.hash==hash && keys_[slot.index]==key)
+			{
+				added = false;
+				return slot.index;
+			}
+		}
+	}
+
+	//Returns the number of keys.
+	int count() const
+	{
+		return keys_.count();
+	}
+
+	//Returns the key with the given index.
+	QByteArrayView key(int index) const
+	{
+		return keys_[index];
+	}
+
+	//Returns the memory used by the table (without arena).
+	qint64 memoryUsage() const
+	{
+		return slots_.count() * sizeof(Slot) + keys_.capacity() * sizeof(QByteArrayView);
+	}
+
+private:
+	struct Slot
+	{
+		quint64 hash = 0;
+		int index = -1;
+	};
+
+	Arena& arena_;
+	QVector<Slot> slots_;
+	quint64 mask_;
+	QVector<QByteArrayView> keys_;
+
+	//doubles the number of slots (keeps the load factor below 0.5)
+	void grow()
+	{
+		QVector<Slot> old(slots_.count()*2);
+		old.swap(slots_);
+		mask_ = slots_.count() - 1;
+		foreach(const Slot& slot, old)
+		{
+			if (slot.index==-1) continue;
+
+			quint64 i = slot.hash&mask_;
+			while (slots_[i].index!=-1) i = (i+1)&mask_;
+			slots_[i] = slot;
+		}
+	}
+};
+
+//Hash table of the build side of a join. Keys can have several values, which are kept in insertion order.
+class TSVJoinTable
+{
+public:
+	TSVJoinTable()
+		: keys_(arena_)
+	{
+	}
+
+	//Adds a value for the key.
+	void add(QByteArrayView key, QByteArrayView value)
+	{
+		bool added = false;
+		int index = keys_.insert(key, added);
+		int row = rows_.count();
+		rows_.append(Row{arena_.store(value), -1});
+		if (added)
+		{
+			heads_.append(row);
+			tails_.append(row);
+		}
+		else
+		{
+			rows_[tails_[index]].next = row;
+			tails_[index] = row;
+		}
+	}
+
+	//Returns the first value row of a key, or -1 if the key is not contained.
+	int first(QByteArrayView key) const
+	{
+		int index = keys_.find(key);
+		return index==-1 ? -1 : heads_[index];
+	}
+	//Returns the next value row of the same key, or -1 if there are no further values.
+	int next(int row) const
+	{
+		return rows_[row].next;
+	}
+	//Returns the value of a row.
+	QByteArrayView value(int row) const
+	{
+		return rows_[row].value;
+	}
+
+	//Returns the number of keys.
+	int keyCount() const
+	{
+		return keys_.count();
+	}
+	//Returns the key with the given index.
+	QByteArrayView key(int index) const
+	{
+		return keys_.key(index);
+	}
+	//Returns the first value row of the key with the given index.
+	int head(int index) const
+	{
+		return heads_[index];
+	}
+
+	//Returns the memory used by the table.
+	qint64 memoryUsage() const
+	{
+		return arena_.bytes() + keys_.memoryUsage() + rows_.capacity() * sizeof(Row) + 2 * heads_.capacity() * sizeof(int);
+	}
+
+private:
+	struct Row
+	{
+		QByteArrayView value;
+		int next;
+	};
+
+	Arena arena_;
+	TSVKeyTable keys_;
+	QVector<Row> rows_;
+	QVector<int> heads_;
+	QVector<int> tails_;
+};
+
+//Names of the aggregate functions (in enum order)
+static const QByteArrayList AGGREGATE_NAMES = {"count", "sum", "min", "max", "mean", "first"};
+
+//Hash table of the groups of a group-by with the aggregate states.
+//The state of a group is one value per aggregate (the count for COUNT, the sum for SUM/MEAN, the minimum/maximum for MIN/MAX), the row count and the first values for FIRST.
+class TSVGroupTable
+{
+public:
+	TSVGroupTable(const QVector<TSVFileJoiner::Aggregate>& aggregates)
+		: aggregates_(aggregates)
+		, keys_(arena_)
+	{
+	}
+
+	//Adds a row.
+	void addRow(QByteArrayView key, const TSVRow& row, QByteArrayView line)
+	{
+		QVector<double> values = rowValues(aggregates_, row, line);
+		QVector<QByteArrayView> firsts(aggregates_.count());
+		for (int a=0; a<aggregates_.count(); ++a)
+		{
+			if (aggregates_[a].function==TSVFileJoiner::FIRST) firsts[a] = row[aggregates_[a].column];
+		}
+		merge(key, values.constData(), 1, firsts);
+	}
+
+	//Adds a serialized state (see rowState() and state()).
+	void addState(QByteArrayView key, const QByteArray& state)
+	{
+		const char* data = state.constData();
+		const int aggs = aggregates_.count();
+		const double* values = reinterpret_cast<const double*>(data);
+		qint64 count = 0;
+		memcpy(&count, data + aggs * sizeof(double), sizeof(count));
+
+		QVector<QByteArrayView> firsts(aggs);
+		qsizetype pos = aggs * sizeof(double) + sizeof(count);
+		for (int a=0; a<aggs; ++a)
+		{
+			if (aggregates_[a].function!=TSVFileJoiner::FIRST) continue;
+
+			quint32 length = 0;
+			memcpy(&length, data + pos, sizeof(length));
+			firsts[a] = QByteArrayView(data + pos + sizeof(length), length);
+			pos += sizeof(length) + length;
+		}
+
+		//values are not necessarily aligned in the serialized state
+		QVector<double> aligned(aggs);
+		memcpy(aligned.data(), values, aggs * sizeof(double));
+		merge(key, aligned.constData(), count, firsts);
+	}
+
+	//Returns the serialized state of a single row.
+	static QByteArray rowState(const QVector<TSVFileJoiner::Aggregate>& aggregates, const TSVRow& row, QByteArrayView line)
+	{
+		QVector<double> values = rowValues(aggregates, row, line);
+		QVector<QByteArrayView> firsts(aggregates.count());
+		for (int a=0; a<aggregates.count(); ++a)
+		{
+			if (aggregates[a].function==TSVFileJoiner::FIRST) firsts[a] = row[aggregates[a].column];
+		}
+		return serialize(aggregates, values.constData(), 1, firsts.constData());
+	}
+
+	//Returns the serialized state of a group.
+	QByteArray state(int group) const
+	{
+		const int aggs = aggregates_.count();
+		return serialize(aggregates_, values_.constData() + group * aggs, counts_[group], firsts_.constData() + group * aggs);
+	}
+
+	//Returns the number of groups.
+	int count() const
+	{
+		return keys_.count();
+	}
+	//Returns the key of a group.
+	QByteArrayView key(int group) const
+	{
+		return keys_.key(group);
+	}
+
+	//Returns the output line of a group (without newline).
+	QByteArray result(int group, char separator) const
+	{
+		QByteArray output = key(group).toByteArray();
+		const int aggs = aggregates_.count();
+		for (int a=0; a<aggs; ++a)
+		{
+			output.append(separator);
+			double value = values_[group * aggs + a];
+			switch(aggregates_[a].function)
+			{
+				case TSVFileJoiner::COUNT:
+					output.append(QByteArray::number(static_cast<qint64>(value)));
+					break;
+				case TSVFileJoiner::MEAN:
+					output.append(QByteArray::number(value / counts_[group], 'g', 15));
+					break;
+				case TSVFileJoiner::FIRST:
+					output.append(firsts_[group * aggs + a]);
+					break;
+				default:
+					output.append(QByteArray::number(value, 'g', 15));
+			}
+		}
+		return output;
+	}
+
+	//Returns the memory used by the table.
+	qint64 memoryUsage() const
+	{
+		return arena_.bytes() + keys_.memoryUsage() + values_.capacity() * sizeof(double) + counts_.capacity() * sizeof(qint64) + firsts_.capacity() * sizeof(QByteArrayView);
+	}
+
+private:
+	QVector<TSVFileJoiner::Aggregate> aggregates_;
+	Arena arena_;
+	TSVKeyTable keys_;
+	QVector<double> values_;
+	QVector<qint64> counts_;
+	QVector<QByteArrayView> firsts_;
+
+	//returns the aggregate values of a single row
+	static QVector<double> rowValues(const QVector<TSVFileJoiner::Aggregate>& aggregates, const TSVRow& row, QByteArrayView line)
+	{
+		QVector<double> values(aggregates.count(), 0.0);
+		for (int a=0; a<aggregates.count(); ++a)
+		{
+			const TSVFileJoiner::Aggregate& aggregate = aggregates[a];
+			if (aggregate.function==TSVFileJoiner::COUNT)
+			{
+				values[a] = 1.0;
+			}
+			else if (aggregate.function!=TSVFileJoiner::FIRST)
+			{
+				values[a] = Helper::toDouble(row[aggregate.column], "value to aggregate", QString::fromUtf8(line));
+			}
+		}
+		return values;
+	}
+
+	//merges a state into the state of the group
+	void merge(QByteArrayView key, const double* values, qint64 count, const QVector<QByteArrayView>& firsts)
+	{
+		bool added = false;
+		int group = keys_.insert(key, added);
+		const int aggs = aggregates_.count();
+		if (added)
+		{
+			for (int a=0; a<aggs; ++a)
+			{
+				values_.append(values[a]);
+				firsts_.append(aggregates_[a].function==TSVFileJoiner::FIRST ? arena_.store(firsts[a]) : QByteArrayView());
+			}
+			counts_.append(count);
+			return;
+		}
+
+		double* group_values = values_.data() + group * aggs;
+		for (int a=0; a<aggs; ++a)
+		{
+			switch(aggregates_[a].function)
+			{
+				case TSVFileJoiner::MIN:
+					group_values[a] = std::min(group_values[a], values[a]);
+					break;
+				case TSVFileJoiner::MAX:
+					group_values[a] = std::max(group_values[a], values[a]);
+					break;
+				case TSVFileJoiner::FIRST:
+					break;
+				default:
+					group_values[a] += values[a];
+			}
+		}
+		counts_[group] += count;
+	}
+
+	//serializes a state
+	static QByteArray serialize(const QVector<TSVFileJoiner::Aggregate>& aggregates, const double* values, qint64 count, const QByteArrayView* firsts)
+	{
+		QByteArray output;
+		output.append(reinterpret_cast<const char*>(values), aggregates.count() * sizeof(double));
+		output.append(reinterpret_cast<const char*>(&count), sizeof(count));
+		for (int a=0; a<aggregates.count(); ++a)
+		{
+			if (aggregates[a].function!=TSVFileJoiner::FIRST) continue;
+
+			quint32 length = firsts[a].size();
+			output.append(reinterpret_cast<const char*>(&length), sizeof(length));
+			output.append(firsts[a]);
+		}
+		return output;
+	}
+};
+
+//Temporary file of (key, payload) records with fast GZ compression.
+class TSVPartitionFile
+{
+public:
+	TSVPartitionFile(QString filename, bool write)
+		: filename_(filename)
+		, gz_(gzopen(filename.toUtf8().constData(), write ? "wb1" : "rb"))
+	{
+		if (gz_==nullptr) THROW(FileAccessException, "Could not open temporary partition file '" + filename + "' for " + (write ? "writing" : "reading") + "!");
+		gzbuffer(gz_, 65536);
+	}
+
+	~TSVPartitionFile()
+	{
+		if (gz_!=nullptr) gzclose(gz_);
+	}
+
+	//Writes a record.
+	void write(QByteArrayView key, QByteArrayView payload)
+	{
+		if (!writeField(key) || !writeField(payload)) THROW(FileAccessException, "Could not write temporary partition file '" + filename_ + "'!");
+	}
+
+	//Reads the next record. Returns false if the end of the file is reached.
+	bool read(QByteArray& key, QByteArray& payload)
+	{
+		quint32 length = 0;
+		int bytes = gzread(gz_, &length, sizeof(length));
+		if (bytes==0) return false;
+		if (bytes!=sizeof(length) || !readField(key, length) || gzread(gz_, &length, sizeof(length))!=sizeof(length) || !readField(payload, length))
+		{
+			THROW(FileParseException, "Truncated temporary partition file '" + filename_ + "'!");
+		}
+		return true;
+	}
+
+	//Closes the file. Throws an error if pending data could not be written.
+	void close()
+	{
+		int result = gzclose(gz_);
+		gz_ = nullptr;
+		if (result!=Z_OK) THROW(FileAccessException, "Could not write temporary partition file '" + filename_ + "'!");
+	}
+
+private:
+	QString filename_;
+	gzFile gz_;
+
+	bool writeField(QByteArrayView data)
+	{
+		quint32 length = data.size();
+		return gzwrite(gz_, &length, sizeof(length))==sizeof(length) && gzwrite(gz_, data.data(), length)==static_cast<int>(length);
+	}
+
+	bool readField(QByteArray& data, quint32 length)
+	{
+		data.resize(length);
+		return gzread(gz_, data.data(), length)==static_cast<int>(length);
+	}
+
+	//declared away methods
+	TSVPartitionFile(const TSVPartitionFile&) = delete;
+	TSVPartitionFile& operator=(const TSVPartitionFile&) = delete;
+};
+
+//Creates temporary partition files for writing.
+static QVector<QSharedPointer<TSVPartitionFile>> createPartitionFiles(int count, QStringList& filenames)
+{
+	QVector<QSharedPointer<TSVPartitionFile>> output;
+	for (int p=0; p<count; ++p)
+	{
+		filenames << Helper::tempFileName(".part.gz");
+		output << QSharedPointer<TSVPartitionFile>(new TSVPartitionFile(filenames.last(), true));
+	}
+	return output;
+}
+
+//Writes the joined lines of a left line to the output.
+static void writeMatches(QIODevice& out, QByteArrayView line, QByteArrayView key, const TSVJoinTable& table, TSVFileJoiner::JoinType type, int value_columns, char separator)
+{
+	int row = table.first(key);
+	if (row==-1)
+	{
+		if (type==TSVFileJoiner::LEFT)
+		{
+			QByteArray output = line.toByteArray();
+			output.append(value_columns, separator);
+			output.append('\n');
+			out.write(output);
+		}
+		return;
+	}
+
+	QByteArray output;
+	for (; row!=-1; row=table.next(row))
+	{
+		output = line.toByteArray();
+		if (value_columns>0)
+		{
+			output.append(separator);
+			output.append(table.value(row));
+		}
+		output.append('\n');
+		out.write(output);
+	}
+}
+
+TSVFileJoiner::TSVFileJoiner(qint64 memory_budget, int threads)
+	: memory_budget_(memory_budget)
+	, threads_(threads>0 ? threads : std::max(1, QThread::idealThreadCount()))
+	, separator_('\t')
+{
+}
+
+void TSVFileJoiner::join(QString left, const QVector<int>& left_keys, QString right, const QVector<int>& right_keys, QString out, JoinType type, char separator, char comment)
+{
+	separator_ = separator;
+	if (left_keys.isEmpty() || left_keys.count()!=right_keys.count()) THROW(ArgumentException, "The left and right join key column count must be equal and greater than zero!");
+	if (right.isEmpty()) THROW(ArgumentException, "The right file of a join cannot be read from stdin!");
+
+	//build hash table from right file - switch to partitions if it does not fit into memory
+	TSVFileStream right_stream(right, separator, comment);
+	checkColumns(right_keys, right_stream.columns(), right);
+	QVector<int> value_cols;
+	for (int c=0; c<right_stream.columns(); ++c)
+	{
+		if (!right_keys.contains(c)) value_cols << c;
+	}
+
+	QSharedPointer<TSVJoinTable> table(new TSVJoinTable());
+	QStringList build_files;
+	QStringList probe_files;
+	QVector<QSharedPointer<TSVPartitionFile>> build_parts;
+	QVector<QSharedPointer<TSVPartitionFile>> probe_parts;
+	auto removeTempFiles = [&]()
+	{
+		build_parts.clear();
+		probe_parts.clear();
+		foreach(const QString& file, build_files + probe_files) QFile::remove(file);
+	};
+
+	try
+	{
+		TSVRowBatch batch;
+		QByteArray key_buffer;
+		QByteArray value;
+		while (right_stream.readBatch(batch)>0)
+		{
+			for (int r=0; r<batch.count(); ++r)
+			{
+				TSVRow row = batch.row(r);
+				QByteArrayView key = rowKey(row, right_keys, key_buffer);
+				value.clear();
+				for (int i=0; i<value_cols.count(); ++i)
+				{
+					if (i>0) value.append(separator_);
+					value.append(row[value_cols[i]]);
+				}
+
+				if (build_parts.isEmpty())
+				{
+					table->add(key, value);
+					if (table->memoryUsage()>memory_budget_)
+					{
+						int partitions = partitionCount(right, table->memoryUsage());
+						build_parts = createPartitionFiles(partitions, build_files);
+						for (int k=0; k<table->keyCount(); ++k)
+						{
+							QByteArrayView table_key = table->key(k);
+							int p = partitionOf(table_key, partitions);
+							for (int value_row=table->head(k); value_row!=-1; value_row=table->next(value_row))
+							{
+								build_parts[p]->write(table_key, table->value(value_row));
+							}
+						}
+						table.reset();
+					}
+				}
+				else
+				{
+					build_parts[partitionOf(key, build_parts.count())]->write(key, value);
+				}
+			}
+		}
+		foreach(const QSharedPointer<TSVPartitionFile>& part, build_parts) part->close();
+	}
+	catch (...)
+	{
+		removeTempFiles();
+		throw;
+	}
+
+	//write comments and header
+	TSVFileStream left_stream(left, separator, comment);
+	checkColumns(left_keys, left_stream.columns(), left);
+	QSharedPointer<QFile> output = Helper::openFileForWriting(out, true);
+	foreach(const QByteArray& line, left_stream.comments())
+	{
+		output->write(line + '\n');
+	}
+	QByteArrayList header = left_stream.header();
+	foreach(int c, value_cols)
+	{
+		header << right_stream.header()[c];
+	}
+	if (std::any_of(header.begin(), header.end(), [](const QByteArray& h){ return !h.isEmpty(); }))
+	{
+		output->write(comment + header.join(separator_) + '\n');
+	}
+
+	//right file fits into memory > stream left file and probe directly
+	if (build_parts.isEmpty())
+	{
+		TSVRowBatch batch;
+		QByteArray key_buffer;
+		while (left_stream.readBatch(batch)>0)
+		{
+			for (int r=0; r<batch.count(); ++r)
+			{
+				writeMatches(*output, batch.line(r), rowKey(batch.row(r), left_keys, key_buffer), *table, type, value_cols.count(), separator_);
+			}
+		}
+		return;
+	}
+
+	//partition left file and join partitions in parallel
+	try
+	{
+		probe_parts = createPartitionFiles(build_parts.count(), probe_files);
+		TSVRowBatch batch;
+		QByteArray key_buffer;
+		while (left_stream.readBatch(batch)>0)
+		{
+			for (int r=0; r<batch.count(); ++r)
+			{
+				QByteArrayView key = rowKey(batch.row(r), left_keys, key_buffer);
+				probe_parts[partitionOf(key, probe_parts.count())]->write(key, batch.line(r));
+			}
+		}
+		foreach(const QSharedPointer<TSVPartitionFile>& part, probe_parts) part->close();
+
+		processPartitions(build_parts.count(), [&](int p, QString out_file)
+		{
+			joinPartition(build_files[p], probe_files[p], out_file, type, value_cols.count());
+		}, *output);
+	}
+	catch (...)
+	{
+		removeTempFiles();
+		throw;
+	}
+	removeTempFiles();
+}
+
+void TSVFileJoiner::groupBy(QString in, const QVector<int>& keys, const QVector<Aggregate>& aggregates, QString out, char separator, char comment)
+{
+	separator_ = separator;
+	if (keys.isEmpty()) THROW(ArgumentException, "No group-by key columns given!");
+	if (aggregates.isEmpty()) THROW(ArgumentException, "No aggregates given!");
+
+	TSVFileStream stream(in, separator, comment);
+	checkColumns(keys, stream.columns(), in);
+	QVector<int> value_cols;
+	foreach(const Aggregate& aggregate, aggregates)
+	{
+		if (aggregate.function!=COUNT) value_cols << aggregate.column;
+	}
+	checkColumns(value_cols, stream.columns(), in);
+
+	//aggregate in memory - switch to partitions if the groups do not fit into memory
+	QSharedPointer<TSVGroupTable> table(new TSVGroupTable(aggregates));
+	QStringList files;
+	QVector<QSharedPointer<TSVPartitionFile>> parts_out;
+	auto removeTempFiles = [&]()
+	{
+		parts_out.clear();
+		foreach(const QString& file, files) QFile::remove(file);
+	};
+
+	try
+	{
+		TSVRowBatch batch;
+		QByteArray key_buffer;
+		while (stream.readBatch(batch)>0)
+		{
+			for (int r=0; r<batch.count(); ++r)
+			{
+				TSVRow row = batch.row(r);
+				QByteArrayView key = rowKey(row, keys, key_buffer);
+				if (parts_out.isEmpty())
+				{
+					table->addRow(key, row, batch.line(r));
+					if (table->memoryUsage()>memory_budget_)
+					{
+						//partial states are written before all later rows of the same group, so FIRST stays correct
+						int partitions = partitionCount(in, table->memoryUsage());
+						parts_out = createPartitionFiles(partitions, files);
+						for (int g=0; g<table->count(); ++g)
+						{
+							parts_out[partitionOf(table->key(g), partitions)]->write(table->key(g), table->state(g));
+						}
+						table.reset();
+					}
+				}
+				else
+				{
+					parts_out[partitionOf(key, parts_out.count())]->write(key, TSVGroupTable::rowState(aggregates, row, batch.line(r)));
+				}
+			}
+		}
+		foreach(const QSharedPointer<TSVPartitionFile>& part, parts_out) part->close();
+	}
+	catch (...)
+	{
+		removeTempFiles();
+		throw;
+	}
+
+	//write comments and header
+	QSharedPointer<QFile> output = Helper::openFileForWriting(out, true);
+	foreach(const QByteArray& line, stream.comments())
+	{
+		output->write(line + '\n');
+	}
+	QByteArrayList header;
+	foreach(int c, keys)
+	{
+		header << stream.header()[c];
+	}
+	foreach(const Aggregate& aggregate, aggregates)
+	{
+		QByteArray name = AGGREGATE_NAMES[aggregate.function];
+		if (aggregate.function!=COUNT)
+		{
+			QByteArray col_name = stream.header()[aggregate.column];
+			name += "(" + (col_name.isEmpty() ? QByteArray::number(aggregate.column+1) : col_name) + ")";
+		}
+		header << name;
+	}
+	output->write(comment + header.join(separator_) + '\n');
+
+	//groups fit into memory > write them directly (in order of first occurrence)
+	if (parts_out.isEmpty())
+	{
+		for (int g=0; g<table->count(); ++g)
+		{
+			output->write(table->result(g, separator_) + '\n');
+		}
+		return;
+	}
+
+	//aggregate partitions in parallel
+	try
+	{
+		processPartitions(files.count(), [&](int p, QString out_file)
+		{
+			groupPartition(files[p], aggregates, out_file);
+		}, *output);
+	}
+	catch (...)
+	{
+		removeTempFiles();
+		throw;
+	}
+	removeTempFiles();
+}
+
+QVector<TSVFileJoiner::Aggregate> TSVFileJoiner::parseAggregates(const QByteArray& aggregates)
+{
+	QVector<Aggregate> output;
+	foreach(QByteArray part, aggregates.split(','))
+	{
+		part = part.trimmed();
+		int sep = part.indexOf(':');
+		QByteArray name = (sep==-1 ? part : part.left(sep)).trimmed().toLower();
+
+		Aggregate aggregate;
+		int index = AGGREGATE_NAMES.indexOf(name);
+		if (index==-1) THROW(ArgumentException, "Invalid aggregate function '" + name + "'! Valid are: " + AGGREGATE_NAMES.join(", "));
+		aggregate.function = static_cast<AggregateFunction>(index);
+
+		if (aggregate.function!=COUNT)
+		{
+			if (sep==-1) THROW(ArgumentException, "Aggregate function '" + name + "' requires a column, e.g. '" + name + ":3'!");
+			aggregate.column = Helper::toInt(part.mid(sep+1), "aggregate column") - 1;
+			if (aggregate.column<0) THROW(ArgumentException, "Invalid 1-based aggregate column '" + part.mid(sep+1) + "'!");
+		}
+
+		output << aggregate;
+	}
+	return output;
+}
+
+QByteArrayView TSVFileJoiner::rowKey(const TSVRow& row, const QVector<int>& keys, QByteArray& buffer) const
+{
+	//single key column > no copy needed
+	if (keys.count()==1) return row[keys[0]];
+
+	buffer.clear();
+	for (int i=0; i<keys.count(); ++i)
+	{
+		if (i>0) buffer.append(separator_);
+		buffer.append(row[keys[i]]);
+	}
+	return buffer;
+}
+
+void TSVFileJoiner::checkColumns(const QVector<int>& columns, int column_count, QString filename)
+{
+	foreach(int c, columns)
+	{
+		if (c<0 || c>=column_count) THROW(ArgumentException, "Column " + QString::number(c+1) + " is not valid for file '" + filename + "' with " + QString::number(column_count) + " columns!");
+	}
+}
+
+int TSVFileJoiner::partitionCount(QString filename, qint64 memory_used) const
+{
+	//estimate the memory needed for the whole input: the hash table needs about twice the size of the file (GZ files are assumed to be compressed about 5-fold)
+	qint64 estimate = 4 * memory_used;
+	if (!filename.isEmpty())
+	{
+		qint64 file_size = QFileInfo(filename).size();
+		if (filename.endsWith(".gz", Qt::CaseInsensitive)) file_size *= 5;
+		estimate = std::max(2 * memory_used, 2 * file_size);
+	}
+
+	//partitions are processed in parallel, so each one has to fit into its share of the memory budget - the number of partitions is limited by the number of open files
+	qint64 partition_budget = std::max(qint64(1048576), memory_budget_ / threads_);
+	qint64 partitions = 2 * (estimate / partition_budget + 1);
+	return static_cast<int>(std::min(qint64(256), std::max(qint64(threads_), partitions)));
+}
+
+void TSVFileJoiner::joinPartition(QString build_file, QString probe_file, QString out_file, JoinType type, int value_columns) const
+{
+	TSVJoinTable table;
+	QByteArray key;
+	QByteArray payload;
+	TSVPartitionFile build(build_file, false);
+	while (build.read(key, payload))
+	{
+		table.add(key, payload);
+	}
+
+	QSharedPointer<QFile> output = Helper::openFileForWriting(out_file);
+	TSVPartitionFile probe(probe_file, false);
+	while (probe.read(key, payload))
+	{
+		writeMatches(*output, payload, key, table, type, value_columns, separator_);
+	}
+}
+
+void TSVFileJoiner::groupPartition(QString file, const QVector<Aggregate>& aggregates, QString out_file) const
+{
+	TSVGroupTable table(aggregates);
+	QByteArray key;
+	QByteArray payload;
+	TSVPartitionFile input(file, false);
+	while (input.read(key, payload))
+	{
+		table.addState(key, payload);
+	}
+
+	QSharedPointer<QFile> output = Helper::openFileForWriting(out_file);
+	for (int g=0; g<table.count(); ++g)
+	{
+		output->write(table.result(g, separator_) + '\n');
+	}
+}
+
+void TSVFileJoiner::processPartitions(int partitions, std::function<void(int, QString)> process, QIODevice& out) const
+{
+	QThreadPool pool;
+	pool.setMaxThreadCount(threads_);
+
+	QStringList out_files;
+	QList<QFuture<QString>> futures;
+	for (int p=0; p<partitions; ++p)
+	{
+		QString out_file = Helper::tempFileName(".tsv");
+		out_files << out_file;
+		futures << QtConcurrent::run(&pool, [process, p, out_file]()
+		{
+			try
+			{
+				process(p, out_file);
+			}
+			catch (Exception& e)
+			{
+				return e.message();
+			}
+			return QString();
+		});
+	}
+
+	//append results in partition order
+	QString error;
+	for (int p=0; p<partitions; ++p)
+	{
+		QString partition_error = futures[p].result();
+		if (error.isEmpty()) error = partition_error;
+		if (error.isEmpty())
+		{
+			QFile file(out_files[p]);
+			if (!file.open(QFile::ReadOnly)) error = "Could not open temporary file '" + out_files[p] + "' for reading!";
+			while (error.isEmpty() && !file.atEnd())
+			{
+				out.write(file.read(1048576));
+			}
+		}
+		QFile::remove(out_files[p]);
+	}
+	if (!error.isEmpty()) THROW(FileAccessException, error);
+}
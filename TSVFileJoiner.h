@@ -0,0 +1,82 @@
+#ifndef TSVFILEJOINER_H
+#define TSVFILEJOINER_H
+
+#include "cppCORE_global.h"
+#include <QString>
+#include <QVector>
+#include <QByteArrayList>
+#include <QIODevice>
+#include <functional>
+
+class TSVRow;
+
+/**
+  @brief Streaming hash join and hash aggregation (group-by) for (large) TSV files.
+
+  The build side (right file of a join, groups of an aggregation) is stored in an open-addressing hash table with keys and values in an arena.
+  If the build side exceeds the memory budget, both inputs are hash-partitioned to compressed temporary files (grace hash join) and the partitions are processed in parallel.
+  When everything fits into memory, the output order follows the left/input file. Otherwise the output is ordered by partition.
+*/
+class CPPCORESHARED_EXPORT TSVFileJoiner
+{
+public:
+	///Join type.
+	enum JoinType
+	{
+		INNER, ///< Rows of the left file with at least one matching row in the right file.
+		LEFT ///< All rows of the left file. The right columns are empty if there is no matching row.
+	};
+
+	///Aggregate function.
+	enum AggregateFunction
+	{
+		COUNT, ///< Number of rows.
+		SUM, ///< Sum of values.
+		MIN, ///< Minimum value.
+		MAX, ///< Maximum value.
+		MEAN, ///< Mean of values.
+		FIRST ///< First value in file order.
+	};
+
+	///Aggregate of a group-by.
+	struct Aggregate
+	{
+		///Aggregate function.
+		AggregateFunction function;
+		///0-based column index (ignored for COUNT).
+		int column = -1;
+	};
+
+	///Constructor. @p memory_budget is the approximate memory used for hash tables in bytes. If @p threads is 0, the ideal thread count is used.
+	TSVFileJoiner(qint64 memory_budget = qint64(1024)*1024*1024, int threads = 0);
+
+	///Joins the left and right file on the given key columns (0-based). The output contains all left columns followed by the non-key columns of the right file.
+	///Each left row is written once per matching right row. Reads the left file from stdin/writes to stdout if the file name is empty.
+	void join(QString left, const QVector<int>& left_keys, QString right, const QVector<int>& right_keys, QString out, JoinType type = INNER, char separator = '\t', char comment = '#');
+	///Groups the input file by the given key columns (0-based) and calculates the aggregates of each group. The output contains the key columns followed by one column per aggregate.
+	///Reads from stdin/writes to stdout if the file name is empty.
+	void groupBy(QString in, const QVector<int>& keys, const QVector<Aggregate>& aggregates, QString out, char separator = '\t', char comment = '#');
+
+	///Parses a comma-separated aggregate list with 1-based column numbers, e.g. 'count,sum:3,mean:4'.
+	static QVector<Aggregate> parseAggregates(const QByteArray& aggregates);
+
+protected:
+	qint64 memory_budget_;
+	int threads_;
+	char separator_;
+
+	//returns the key of a row (key columns joined with the separator). @p buffer is used for keys with several columns.
+	QByteArrayView rowKey(const TSVRow& row, const QVector<int>& keys, QByteArray& buffer) const;
+	//checks that the key columns are present in the file
+	static void checkColumns(const QVector<int>& columns, int column_count, QString filename);
+	//returns the number of partitions used when the build side does not fit into memory
+	int partitionCount(QString filename, qint64 memory_used) const;
+	//joins a pair of partition files
+	void joinPartition(QString build_file, QString probe_file, QString out_file, JoinType type, int value_columns) const;
+	//aggregates a partition file
+	void groupPartition(QString file, const QVector<Aggregate>& aggregates, QString out_file) const;
+	//processes the partitions in parallel and appends the results to the output in partition order
+	void processPartitions(int partitions, std::function<void(int, QString)> process, QIODevice& out) const;
+};
+
+#endif // TSVFILEJOINER_H
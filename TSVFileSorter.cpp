@@ -0,0 +1,316 @@
+#include "TSVFileSorter.h"
+#include "TSVFileStream.h"
+#include "Exceptions.h"
+#include "Helper.h"
+#include <QFile>
+#include <QThread>
+#include <QFuture>
+#include <QSharedPointer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
+#include <zlib.h>
+
+//Reads the lines of a sorted run from a temporary file
+class TSVSortRunReader
+{
+public:
+	TSVSortRunReader(QString filename)
+		: filename_(filename)
+		, gz_(gzopen(filename.toUtf8().constData(), "rb"))
+	{
+		if (gz_==nullptr) THROW(FileAccessException, "Could not open temporary sort file '" + filename + "' for reading!");
+		gzbuffer(gz_, 1048576);
+	}
+
+	~TSVSortRunReader()
+	{
+		gzclose(gz_);
+	}
+
+	//Reads the next line. Returns false if the end of the file is reached.
+	bool next(QByteArray& line)
+	{
+		quint32 length = 0;
+		int bytes = gzread(gz_, &length, sizeof(length));
+		if (bytes==0) return false;
+		if (bytes!=sizeof(length)) THROW(FileParseException, "Truncated temporary sort file '" + filename_ + "'!");
+
+		line.resize(length);
+		if (gzread(gz_, line.data(), length)!=static_cast<int>(length)) THROW(FileParseException, "Truncated temporary sort file '" + filename_ + "'!");
+
+		return true;
+	}
+
+private:
+	QString filename_;
+	gzFile gz_;
+
+	//declared away methods
+	TSVSortRunReader(const TSVSortRunReader&) = delete;
+	TSVSortRunReader& operator=(const TSVSortRunReader&) = delete;
+};
+
+TSVFileSorter::TSVFileSorter(const QVector<Key>& keys, qint64 memory_budget, int threads)
+	: keys_(keys)
+	, memory_budget_(memory_budget)
+	, threads_(threads>0 ? threads : std::max(1, QThread::idealThreadCount()))
+	, separator_('\t')
+	, max_key_col_(-1)
+{
+	if (keys_.isEmpty()) THROW(ArgumentException, "No sort keys given!");
+	foreach(const Key& key, keys_)
+	{
+		if (key.column<0) THROW(ArgumentException, "Invalid sort key column " + QString::number(key.column) + "!");
+		max_key_col_ = std::max(max_key_col_, key.column);
+	}
+}
+
+void TSVFileSorter::sort(QString in, QString out, char separator, char comment)
+{
+	separator_ = separator;
+
+	TSVFileStream stream(in, separator, comment);
+	if (max_key_col_>=stream.columns()) THROW(ArgumentException, "Sort key column " + QString::number(max_key_col_+1) + " exceeds the column count of " + QString::number(stream.columns()) + " in file '" + in + "'!");
+
+	//create sorted runs in parallel: one batch is filled while up to 'threads' batches are sorted and spilled
+	qint64 run_budget = std::max(qint64(1048576), memory_budget_ / (threads_ + 1));
+	QStringList runs;
+	QList<QFuture<QString>> pending;
+	QVector<Row> batch;
+	qint64 batch_size = 0;
+
+	auto waitForRun = [&pending]()
+	{
+		QString error = pending.takeFirst().result();
+		if (!error.isEmpty()) THROW(FileAccessException, error);
+	};
+	auto spill = [&]()
+	{
+		QString run_file = Helper::tempFileName(".sort_run.gz");
+		runs << run_file;
+		QSharedPointer<QVector<Row>> data(new QVector<Row>());
+		data->swap(batch);
+		batch_size = 0;
+
+		pending << QtConcurrent::run([this, data, run_file]()
+		{
+			try
+			{
+				sortAndSpill(*data, run_file);
+			}
+			catch (Exception& e)
+			{
+				return e.message();
+			}
+			return QString();
+		});
+		while (pending.count()>=threads_) waitForRun();
+	};
+
+	try
+	{
+		while (!stream.atEnd())
+		{
+			QByteArrayList parts = stream.readLine();
+			if (parts.isEmpty()) continue;
+
+			batch.append(createRow(parts.join(separator_)));
+			batch_size += rowSize(batch.last());
+			if (batch_size>=run_budget) spill();
+		}
+		if (!runs.isEmpty() && !batch.isEmpty()) spill();
+		while (!pending.isEmpty()) waitForRun();
+	}
+	catch (...)
+	{
+		while (!pending.isEmpty()) pending.takeFirst().waitForFinished();
+		foreach(const QString& run, runs) QFile::remove(run);
+		throw;
+	}
+
+	//write comments and header
+	QSharedPointer<QFile> output = Helper::openFileForWriting(out, true);
+	foreach(const QByteArray& line, stream.comments())
+	{
+		output->write(line + '\n');
+	}
+	const QByteArrayList& header = stream.header();
+	if (std::any_of(header.begin(), header.end(), [](const QByteArray& h){ return !h.isEmpty(); }))
+	{
+		output->write(comment + header.join(separator_) + '\n');
+	}
+
+	//data fits into memory > sort and write it directly
+	if (runs.isEmpty())
+	{
+		std::stable_sort(batch.begin(), batch.end(), [this](const Row& a, const Row& b){ return lessThan(a, b); });
+		foreach(const Row& row, batch)
+		{
+			output->write(row.line + '\n');
+		}
+		return;
+	}
+
+	//merge runs
+	try
+	{
+		merge(runs, *output);
+	}
+	catch (...)
+	{
+		foreach(const QString& run, runs) QFile::remove(run);
+		throw;
+	}
+	foreach(const QString& run, runs) QFile::remove(run);
+}
+
+QVector<TSVFileSorter::Key> TSVFileSorter::parseKeys(const QByteArray& keys)
+{
+	QVector<Key> output;
+	foreach(QByteArray part, keys.split(','))
+	{
+		part = part.trimmed();
+
+		Key key;
+		while (part.endsWith('n') || part.endsWith('r'))
+		{
+			if (part.endsWith('n')) key.numeric = true;
+			if (part.endsWith('r')) key.reverse = true;
+			part.chop(1);
+		}
+		key.column = Helper::toInt(part, "sort key column") - 1;
+		if (key.column<0) THROW(ArgumentException, "Invalid 1-based sort key column '" + part + "'!");
+
+		output << key;
+	}
+	return output;
+}
+
+TSVFileSorter::Row TSVFileSorter::createRow(const QByteArray& line) const
+{
+	Row row;
+	row.line = line;
+
+	QByteArrayList parts = line.split(separator_);
+	if (parts.count()<=max_key_col_) THROW(FileParseException, "Line has only " + QString::number(parts.count()) + " columns, but sort key column " + QString::number(max_key_col_+1) + " is required: " + line);
+
+	row.numbers.resize(keys_.count());
+	row.strings.reserve(keys_.count());
+	for (int k=0; k<keys_.count(); ++k)
+	{
+		const Key& key = keys_[k];
+		if (key.numeric)
+		{
+			row.numbers[k] = Helper::toDouble(parts[key.column], "numeric sort key", line);
+			row.strings << QByteArray();
+		}
+		else
+		{
+			row.strings << parts[key.column];
+		}
+	}
+
+	return row;
+}
+
+bool TSVFileSorter::lessThan(const Row& a, const Row& b) const
+{
+	for (int k=0; k<keys_.count(); ++k)
+	{
+		const Key& key = keys_[k];
+		int cmp = 0;
+		if (key.numeric)
+		{
+			cmp = (a.numbers[k]<b.numbers[k]) ? -1 : (b.numbers[k]<a.numbers[k] ? 1 : 0);
+		}
+		else
+		{
+			cmp = a.strings[k].compare(b.strings[k]);
+		}
+		if (cmp!=0) return key.reverse ? cmp>0 : cmp<0;
+	}
+
+	return false;
+}
+
+void TSVFileSorter::sortAndSpill(QVector<Row>& rows, QString filename) const
+{
+	std::stable_sort(rows.begin(), rows.end(), [this](const Row& a, const Row& b){ return lessThan(a, b); });
+
+	//write length-prefixed lines with fast compression
+	gzFile gz = gzopen(filename.toUtf8().constData(), "wb1");
+	if (gz==nullptr) THROW(FileAccessException, "Could not open temporary sort file '" + filename + "' for writing!");
+	gzbuffer(gz, 1048576);
+
+	bool ok = true;
+	foreach(const Row& row, rows)
+	{
+		quint32 length = row.line.size();
+		ok = gzwrite(gz, &length, sizeof(length))==sizeof(length) && gzwrite(gz, row.line.constData(), length)==static_cast<int>(length);
+		if (!ok) break;
+	}
+	ok = (gzclose(gz)==Z_OK) && ok;
+	if (!ok) THROW(FileAccessException, "Could not write temporary sort file '" + filename + "'!");
+
+	rows.clear();
+	rows.squeeze();
+}
+
+void TSVFileSorter::merge(const QStringList& runs, QIODevice& out) const
+{
+	const int k = runs.count();
+
+	QVector<QSharedPointer<TSVSortRunReader>> readers;
+	QVector<Row> current(k);
+	QVector<bool> valid(k);
+	QByteArray line;
+	for (int i=0; i<k; ++i)
+	{
+		readers << QSharedPointer<TSVSortRunReader>(new TSVSortRunReader(runs[i]));
+		valid[i] = readers[i]->next(line);
+		if (valid[i]) current[i] = createRow(line);
+	}
+
+	//returns if run a comes before run b - exhausted runs come last, ties are resolved by run index to keep the sort stable
+	auto beats = [&](int a, int b)
+	{
+		if (!valid[a] || !valid[b]) return valid[a] || (!valid[b] && a<b);
+		if (lessThan(current[a], current[b])) return true;
+		if (lessThan(current[b], current[a])) return false;
+		return a<b;
+	};
+
+	//build loser tree: internal nodes 1..k-1 store the loser, node 0 the overall winner, leaf of run i is node k+i
+	QVector<int> tree(k, -1);
+	std::function<int(int)> build = [&](int node)
+	{
+		if (node>=k) return node - k;
+		int left = build(2*node);
+		int right = build(2*node+1);
+		if (beats(left, right))
+		{
+			tree[node] = right;
+			return left;
+		}
+		tree[node] = left;
+		return right;
+	};
+	tree[0] = build(1);
+
+	//merge: output winner, advance its run and replay the matches on the path to the root
+	while (valid[tree[0]])
+	{
+		int winner = tree[0];
+		out.write(current[winner].line + '\n');
+
+		valid[winner] = readers[winner]->next(line);
+		if (valid[winner]) current[winner] = createRow(line);
+
+		for (int node=(winner+k)/2; node>0; node/=2)
+		{
+			if (beats(tree[node], winner)) std::swap(tree[node], winner);
+		}
+		tree[0] = winner;
+	}
+}
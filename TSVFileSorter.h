@@ -0,0 +1,69 @@
+#ifndef TSVFILESORTER_H
+#define TSVFILESORTER_H
+
+#include "cppCORE_global.h"
+#include <QString>
+#include <QVector>
+#include <QByteArrayList>
+#include <QIODevice>
+
+/**
+  @brief External merge sort for (large) TSV files.
+
+  Sorted runs are created in parallel within the given memory budget and spilled to compressed temporary files if the data does not fit into memory.
+  The runs are merged using a loser tree. Sorting is stable. Comment lines and the header line are preserved.
+*/
+class CPPCORESHARED_EXPORT TSVFileSorter
+{
+public:
+	///Sort key.
+	struct Key
+	{
+		///0-based column index.
+		int column;
+		///Numeric comparison (otherwise string comparison).
+		bool numeric = false;
+		///Descending order.
+		bool reverse = false;
+	};
+
+	///Constructor. @p memory_budget is the approximate memory used for the rows in bytes. If @p threads is 0, the ideal thread count is used.
+	TSVFileSorter(const QVector<Key>& keys, qint64 memory_budget = qint64(1024)*1024*1024, int threads = 0);
+
+	///Sorts the input file and writes the result to the output file. Reads from stdin/writes to stdout if the file name is empty.
+	void sort(QString in, QString out, char separator = '\t', char comment = '#');
+
+	///Parses a comma-separated key list with 1-based column numbers and optional flags 'n' (numeric) and 'r' (reverse), e.g. '1,2n,3nr'.
+	static QVector<Key> parseKeys(const QByteArray& keys);
+
+protected:
+	//row with pre-parsed sort keys
+	struct Row
+	{
+		QByteArray line;
+		QVector<double> numbers;
+		QByteArrayList strings;
+	};
+
+	QVector<Key> keys_;
+	qint64 memory_budget_;
+	int threads_;
+	char separator_;
+	int max_key_col_;
+
+	//creates a row with pre-parsed keys
+	Row createRow(const QByteArray& line) const;
+	//compares two rows
+	bool lessThan(const Row& a, const Row& b) const;
+	//sorts a run and stores it to a temporary file
+	void sortAndSpill(QVector<Row>& rows, QString filename) const;
+	//merges the runs into the output
+	void merge(const QStringList& runs, QIODevice& out) const;
+	//approximate memory usage of a row
+	static qint64 rowSize(const Row& row)
+	{
+		return 64 + row.line.size() + 8 * row.numbers.size() + 32 * row.strings.size();
+	}
+};
+
+#endif // TSVFILESORTER_H
@@ -1,5 +1,7 @@
 #include "TSVFileStream.h"
 #include "Helper.h"
+#include "BasicStatistics.h"
+#include <QFile>
 
 TSVFileStream::TSVFileStream(QString filename, char separator, char comment)
 	: filename_(filename)
@@ -101,6 +103,30 @@ QByteArrayList TSVFileStream::readLine()
 	return parts;
 }
 
+int TSVFileStream::readBatch(TSVRowBatch& batch, int max_rows)
+{
+	batch.clear(columns());
+	while (batch.count()<max_rows && !atEnd())
+	{
+		QByteArray line;
+		if (!next_line_.isNull()) //first content line
+		{
+			line.swap(next_line_);
+		}
+		else
+		{
+			line = file_->readLine(true);
+			++line_;
+			if (line.startsWith(double_comment_)) continue; //comments between lines are ignored
+		}
+		if (line.isEmpty()) continue;
+
+		if (!batch.append(line, separator_)) THROW(FileParseException, "Expected " + QString::number(columns()) + " columns, but got " + QString::number(line.count(separator_)+1) + " columns in line " + QString::number(line_) + ": " + line);
+	}
+
+	return batch.count();
+}
+
 int TSVFileStream::colIndex(QByteArray name, bool error_when_missing)
 {
 	//find matching indices
@@ -162,3 +188,131 @@ QVector<int> TSVFileStream::checkColumns(const QByteArrayList& col_names, bool n
 
 	return col_indices;
 }
+
+void TSVFileStream::seekToLine(qint64 n)
+{
+	const TSVFileIndex::Checkpoint& checkpoint = index().checkpoint(n);
+
+	seekToOffset(checkpoint.offset);
+	line_ = checkpoint.line - 1;
+
+	//skip lines up to the requested line
+	for (qint64 row=checkpoint.row; row<n; ++row)
+	{
+		readLine();
+	}
+}
+
+qint64 TSVFileStream::rowCount()
+{
+	return index().rowCount();
+}
+
+QList<QByteArrayList> TSVFileStream::readRegion(const QByteArray& chr, int start, int end, int chr_col, int start_col, int end_col)
+{
+	QList<QByteArrayList> output;
+
+	qint64 offset = index(chr_col, start_col, end_col).regionOffset(chr, start, end);
+	if (offset==-1) return output;
+
+	seekToOffset(offset);
+	line_ = -1;
+
+	while (!atEnd())
+	{
+		QByteArrayList parts = readLine();
+		if (parts.isEmpty()) continue;
+
+		//lines are sorted > stop at first line after the region
+		if (parts[chr_col]!=chr) break;
+		int line_start = Helper::toInt(parts[start_col], "start position", parts.join(separator_));
+		if (line_start>end) break;
+
+		int line_end = Helper::toInt(parts[end_col], "end position", parts.join(separator_));
+		if (BasicStatistics::rangeOverlaps(line_start, line_end, start, end))
+		{
+			output << parts;
+		}
+	}
+
+	return output;
+}
+
+const TSVFileIndex& TSVFileStream::index(int chr_col, int start_col, int end_col)
+{
+	if (filename_.isEmpty() || Helper::isHttpUrl(filename_)) THROW(NotImplementedException, "Indexed access is only supported for local files, but not for '" + (filename_.isEmpty() ? QString("stdin") : filename_) + "'!");
+
+	auto isUsable = [&](const TSVFileIndex& idx)
+	{
+		return idx.isUpToDate(filename_) && (chr_col==-1 || idx.hasRegionIndex(chr_col, start_col, end_col));
+	};
+
+	//load from sidecar file
+	QString index_file = TSVFileIndex::indexFileName(filename_);
+	if ((index_.isNull() || !isUsable(*index_)) && QFile::exists(index_file))
+	{
+		index_ = QSharedPointer<TSVFileIndex>(new TSVFileIndex(TSVFileIndex::load(index_file)));
+	}
+
+	//(re-)create index
+	if (index_.isNull() || !isUsable(*index_))
+	{
+		index_ = QSharedPointer<TSVFileIndex>(new TSVFileIndex(TSVFileIndex::build(filename_, 1000, chr_col, start_col, end_col, separator_, comment_)));
+		if (Helper::isWritable(index_file)) index_->store(index_file);
+	}
+
+	return *index_;
+}
+
+void TSVFileStream::seekToOffset(qint64 offset)
+{
+	next_line_ = QByteArray();
+
+	bool ok = false;
+	if (file_->mode()==VersatileFile::LOCAL)
+	{
+		ok = file_->seek(offset);
+	}
+	else if (file_->mode()==VersatileFile::LOCAL_GZ)
+	{
+		ok = file_->seekBgzf(offset);
+	}
+	if (!ok) THROW(FileAccessException, "Could not seek to offset " + QString::number(offset) + " in file '" + filename_ + "'!");
+}
+
+void TSVRowBatch::clear(int columns)
+{
+	columns_ = columns;
+	arena_.clear();
+	lines_.clear();
+	fields_.clear();
+}
+
+bool TSVRowBatch::append(QByteArrayView line, char separator)
+{
+	QByteArrayView stored = arena_.store(line);
+
+	//split into fields without allocation
+	qsizetype fields_before = fields_.count();
+	qsizetype start = 0;
+	while (true)
+	{
+		qsizetype end = stored.indexOf(separator, start);
+		if (end==-1)
+		{
+			fields_.append(stored.mid(start));
+			break;
+		}
+		fields_.append(stored.mid(start, end-start));
+		start = end + 1;
+	}
+
+	if (fields_.count()-fields_before!=columns_)
+	{
+		fields_.resize(fields_before);
+		return false;
+	}
+
+	lines_.append(stored);
+	return true;
+}
@@ -4,6 +4,81 @@
 #include "cppCORE_global.h"
 #include <QVector>
 #include "VersatileFile.h"
+#include "TSVFileIndex.h"
+#include "Arena.h"
+
+///Row of a TSVRowBatch. The fields reference memory owned by the batch.
+class CPPCORESHARED_EXPORT TSVRow
+{
+public:
+	TSVRow(const QByteArrayView* fields, int count)
+		: fields_(fields)
+		, count_(count)
+	{
+	}
+
+	///Returns the number of fields.
+	int count() const
+	{
+		return count_;
+	}
+	///Returns a field.
+	QByteArrayView operator[](int i) const
+	{
+		return fields_[i];
+	}
+
+protected:
+	const QByteArrayView* fields_;
+	int count_;
+};
+
+/**
+  @brief Batch of content lines read by TSVFileStream::readBatch().
+
+  Lines and fields are stored in an arena owned by the batch, so that parsing does not allocate memory per field.
+  The memory is released at once and re-used when the next batch is read, i.e. lines and fields are only valid until then.
+*/
+class CPPCORESHARED_EXPORT TSVRowBatch
+{
+public:
+	///Default constructor.
+	TSVRowBatch()
+		: columns_(0)
+	{
+	}
+
+	///Returns the number of rows.
+	int count() const
+	{
+		return lines_.count();
+	}
+	///Returns a row split into fields.
+	TSVRow row(int i) const
+	{
+		return TSVRow(fields_.constData() + static_cast<qsizetype>(i) * columns_, columns_);
+	}
+	///Returns a line (without line ending).
+	QByteArrayView line(int i) const
+	{
+		return lines_[i];
+	}
+
+	///Removes all rows and sets the number of columns. Keeps the memory for re-use.
+	void clear(int columns);
+	///Copies a line into the batch and splits it into fields. Returns false if the number of fields does not match the number of columns.
+	bool append(QByteArrayView line, char separator);
+
+protected:
+	int columns_;
+	Arena arena_;
+	QVector<QByteArrayView> lines_;
+	QVector<QByteArrayView> fields_;
+
+	//declared away methods
+	TSVRowBatch(const TSVRowBatch&) = delete;
+	TSVRowBatch& operator=(const TSVRowBatch&) = delete;
+};
 
 /**
   @brief TSV file parser as stream.
@@ -26,6 +101,9 @@ public:
 
 	///Returns the current line, split to columns. Note: Empty lines are returned as an empty array.
 	QByteArrayList readLine();
+	///Reads up to @p max_rows content lines into the batch and returns the number of lines read. Empty lines are skipped.
+	///Fields are stored in the arena of the batch instead of one QByteArray per field, which avoids many small allocations when parsing large files.
+	int readBatch(TSVRowBatch& batch, int max_rows = 10000);
 
 	///Returns the split header line. If no header is present, a list with empty string is returned.
 	const QByteArrayList& header() const
@@ -58,6 +136,16 @@ public:
 	///Checks and converts a comma-separated list of columns (names or 1-based indices) to 0-based numeric indices.
 	QVector<int> checkColumns(const QByteArrayList& col_names, bool numeric);
 
+	///Seeks to the content line with the given 0-based index (header and comment lines are not counted), i.e. the next call of readLine() returns this line.
+	///Uses the line index sidecar file (see TSVFileIndex), which is created if missing or outdated. Works for plain and BGZF-compressed files.
+	void seekToLine(qint64 n);
+	///Returns the number of content lines using the line index sidecar file.
+	qint64 rowCount();
+	///Returns all lines overlapping the given region (1-based closed coordinates). The file must be sorted by chromosome and start position.
+	///Uses the interval index sidecar file (see TSVFileIndex), which is created if missing or outdated. Column indices are 0-based, @p end_col can be equal to @p start_col for single-position data.
+	///Note: After calling this method, lineIndex() is no longer valid until reset() or seekToLine() is called.
+	QList<QByteArrayList> readRegion(const QByteArray& chr, int start, int end, int chr_col, int start_col, int end_col);
+
 protected:
 	QString filename_;
 	char separator_;
@@ -68,6 +156,12 @@ protected:
 	QByteArrayList comments_;
 	QByteArrayList header_;
 	int line_;
+	QSharedPointer<TSVFileIndex> index_;
+
+	//Returns the index, which is loaded from the sidecar file or created if necessary.
+	const TSVFileIndex& index(int chr_col=-1, int start_col=-1, int end_col=-1);
+	//Seeks the underlying file to an offset of the index.
+	void seekToOffset(qint64 offset);
 
     //declared away methods
 	TSVFileStream(const TSVFileStream& ) = delete;
@@ -0,0 +1,365 @@
+#include "UringFileReader.h"
+#include "Exceptions.h"
+
+#ifdef CPPCORE_IO_URING
+#include <liburing.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#endif
+
+UringFileReader::UringFileReader(QString filename, int block_size, int queue_depth)
+	: filename_(filename)
+	, block_size_(block_size)
+	, queue_depth_(queue_depth)
+	, fd_(-1)
+	, file_size_(0)
+	, ring_(nullptr)
+	, buffers_registered_(false)
+	, current_(0)
+	, current_pos_(0)
+	, pos_(0)
+	, next_offset_(0)
+{
+	if (block_size_<4096) THROW(ArgumentException, "Invalid io_uring block size " + QString::number(block_size_) + " - at least 4096 bytes are required!");
+	if (queue_depth_<1) THROW(ArgumentException, "Invalid io_uring queue depth " + QString::number(queue_depth_) + "!");
+}
+
+UringFileReader::~UringFileReader()
+{
+	close();
+}
+
+bool UringFileReader::isAvailable()
+{
+#ifdef CPPCORE_IO_URING
+	//io_uring can be disabled in the kernel or blocked by seccomp (e.g. in containers) > check once
+	static const bool available = []()
+	{
+		struct io_uring ring;
+		if (io_uring_queue_init(2, &ring, 0)!=0) return false;
+		io_uring_queue_exit(&ring);
+		return true;
+	}();
+	return available;
+#else
+	return false;
+#endif
+}
+
+#ifdef CPPCORE_IO_URING
+
+bool UringFileReader::open()
+{
+	if (isOpen()) THROW(ProgrammingException, "UringFileReader::open called on already open file '" + filename_ + "'!");
+
+	//open file
+	fd_ = ::open(filename_.toUtf8().constData(), O_RDONLY);
+	if (fd_==-1) return false;
+	struct stat file_stat;
+	if (fstat(fd_, &file_stat)!=0 || !S_ISREG(file_stat.st_mode))
+	{
+		close();
+		return false;
+	}
+	file_size_ = file_stat.st_size;
+	posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	//init ring
+	ring_ = new io_uring();
+	if (io_uring_queue_init(queue_depth_, ring_, 0)!=0)
+	{
+		delete ring_;
+		ring_ = nullptr;
+		close();
+		return false;
+	}
+
+	//allocate page-aligned buffers
+	slots_.resize(queue_depth_);
+	QVector<iovec> iovecs;
+	for (Slot& slot : slots_)
+	{
+		void* buffer = nullptr;
+		if (posix_memalign(&buffer, 4096, block_size_)!=0)
+		{
+			close();
+			return false;
+		}
+		slot.buffer = static_cast<char*>(buffer);
+		iovecs.append(iovec{buffer, static_cast<size_t>(block_size_)});
+	}
+
+	//register buffers to avoid page mapping for each read - this fails if the memlock limit is too low, so we continue without it
+	buffers_registered_ = io_uring_register_buffers(ring_, iovecs.constData(), iovecs.count())==0;
+
+	restart(0);
+
+	return true;
+}
+
+void UringFileReader::close()
+{
+	if (ring_!=nullptr)
+	{
+		try
+		{
+			drain();
+		}
+		catch (...)
+		{
+			//errors of reads that are no longer needed are irrelevant
+		}
+		if (buffers_registered_) io_uring_unregister_buffers(ring_);
+		io_uring_queue_exit(ring_);
+		delete ring_;
+		ring_ = nullptr;
+	}
+	buffers_registered_ = false;
+
+	for (Slot& slot : slots_)
+	{
+		free(slot.buffer);
+	}
+	slots_.clear();
+
+	if (fd_!=-1)
+	{
+		::close(fd_);
+		fd_ = -1;
+	}
+	file_size_ = 0;
+	pos_ = 0;
+}
+
+QByteArray UringFileReader::read(qint64 maxlen)
+{
+	if (!isOpen()) THROW(ProgrammingException, "UringFileReader::read called on not open file '" + filename_ + "'!");
+
+	QByteArray output;
+	output.reserve(qMin(maxlen, file_size_-pos_));
+	while (output.size()<maxlen && ensureData())
+	{
+		const Slot& slot = slots_[current_];
+		int count = static_cast<int>(qMin(static_cast<qint64>(slot.bytes - current_pos_), maxlen - output.size()));
+		output.append(slot.buffer + current_pos_, count);
+		current_pos_ += count;
+		pos_ += count;
+	}
+
+	return output;
+}
+
+QByteArray UringFileReader::readLine()
+{
+	if (!isOpen()) THROW(ProgrammingException, "UringFileReader::readLine called on not open file '" + filename_ + "'!");
+
+	QByteArray output;
+	while (ensureData())
+	{
+		const Slot& slot = slots_[current_];
+		const char* start = slot.buffer + current_pos_;
+		int available = slot.bytes - current_pos_;
+		const char* newline = static_cast<const char*>(memchr(start, '\n', available));
+		int count = newline==nullptr ? available : static_cast<int>(newline - start) + 1;
+		output.append(start, count);
+		current_pos_ += count;
+		pos_ += count;
+
+		if (newline!=nullptr) break;
+	}
+
+	return output;
+}
+
+bool UringFileReader::seek(qint64 pos)
+{
+	if (!isOpen()) THROW(ProgrammingException, "UringFileReader::seek called on not open file '" + filename_ + "'!");
+	if (pos<0 || pos>file_size_) return false;
+
+	//seek inside the current buffer without discarding the queued reads
+	const Slot& slot = slots_[current_];
+	if (slot.state==READY && pos>=slot.offset && pos<slot.offset+slot.bytes)
+	{
+		current_pos_ = static_cast<int>(pos - slot.offset);
+		pos_ = pos;
+		return true;
+	}
+
+	drain();
+	restart(pos);
+
+	return true;
+}
+
+void UringFileReader::submit(int slot_index)
+{
+	Slot& slot = slots_[slot_index];
+	slot.state = IDLE;
+	slot.bytes = 0;
+	slot.error = 0;
+	if (next_offset_>=file_size_) return;
+
+	slot.offset = next_offset_;
+	slot.requested = static_cast<int>(qMin(static_cast<qint64>(block_size_), file_size_ - next_offset_));
+	next_offset_ += slot.requested;
+
+	io_uring_sqe* sqe = io_uring_get_sqe(ring_);
+	if (sqe==nullptr) THROW(ProgrammingException, "No io_uring submission queue entry available for file '" + filename_ + "'!");
+	if (buffers_registered_)
+	{
+		io_uring_prep_read_fixed(sqe, fd_, slot.buffer, slot.requested, slot.offset, slot_index);
+	}
+	else
+	{
+		io_uring_prep_read(sqe, fd_, slot.buffer, slot.requested, slot.offset);
+	}
+	io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<quintptr>(slot_index)));
+
+	int result = io_uring_submit(ring_);
+	if (result<0) THROW(FileAccessException, "Could not queue io_uring read for file '" + filename_ + "': " + strerror(-result));
+	slot.state = IN_FLIGHT;
+}
+
+void UringFileReader::reap()
+{
+	io_uring_cqe* cqe = nullptr;
+	int result = io_uring_wait_cqe(ring_, &cqe);
+	if (result==-EINTR) return;
+	if (result<0) THROW(FileAccessException, "Waiting for io_uring read of file '" + filename_ + "' failed: " + strerror(-result));
+
+	int slot_index = static_cast<int>(reinterpret_cast<quintptr>(io_uring_cqe_get_data(cqe)));
+	int bytes = cqe->res;
+	io_uring_cqe_seen(ring_, cqe);
+
+	Slot& slot = slots_[slot_index];
+	slot.state = READY;
+	if (bytes<0)
+	{
+		slot.error = -bytes;
+		return;
+	}
+
+	//short read (e.g. on network file systems) > read the rest synchronously
+	while (bytes<slot.requested)
+	{
+		ssize_t count = pread(fd_, slot.buffer + bytes, slot.requested - bytes, slot.offset + bytes);
+		if (count<0 && errno==EINTR) continue;
+		if (count<0)
+		{
+			slot.error = errno;
+			return;
+		}
+		if (count==0) break; //file was truncated
+		bytes += count;
+	}
+	slot.bytes = bytes;
+}
+
+void UringFileReader::waitFor(int slot_index)
+{
+	while (slots_[slot_index].state==IN_FLIGHT)
+	{
+		reap();
+	}
+
+	const Slot& slot = slots_[slot_index];
+	if (slot.error!=0) THROW(FileAccessException, "Could not read from file '" + filename_ + "' at offset " + QString::number(slot.offset) + ": " + strerror(slot.error));
+}
+
+void UringFileReader::drain()
+{
+	for (int i=0; i<slots_.count(); ++i)
+	{
+		while (slots_[i].state==IN_FLIGHT)
+		{
+			reap();
+		}
+	}
+}
+
+void UringFileReader::restart(qint64 pos)
+{
+	next_offset_ = pos;
+	for (int i=0; i<slots_.count(); ++i)
+	{
+		submit(i);
+	}
+	current_ = 0;
+	current_pos_ = 0;
+	pos_ = pos;
+}
+
+bool UringFileReader::ensureData()
+{
+	while (true)
+	{
+		//also for slots that are already reaped, because read-ahead slots can complete with an error while waiting for another slot
+		waitFor(current_);
+		Slot& slot = slots_[current_];
+		if (slot.state==IDLE) return false; //nothing queued > end of file
+		if (current_pos_<slot.bytes) return true;
+		if (slot.bytes==0) return false; //file was truncated
+
+		//buffer consumed > re-use it for the next read and continue with the next buffer
+		submit(current_);
+		current_ = (current_ + 1) % slots_.count();
+		current_pos_ = 0;
+	}
+}
+
+#else
+
+bool UringFileReader::open()
+{
+	return false;
+}
+
+void UringFileReader::close()
+{
+}
+
+QByteArray UringFileReader::read(qint64 /*maxlen*/)
+{
+	THROW(NotImplementedException, "UringFileReader is not available - compile with 'CONFIG+=io_uring' to enable it!");
+}
+
+QByteArray UringFileReader::readLine()
+{
+	THROW(NotImplementedException, "UringFileReader is not available - compile with 'CONFIG+=io_uring' to enable it!");
+}
+
+bool UringFileReader::seek(qint64 /*pos*/)
+{
+	THROW(NotImplementedException, "UringFileReader is not available - compile with 'CONFIG+=io_uring' to enable it!");
+}
+
+void UringFileReader::submit(int /*slot*/)
+{
+}
+
+void UringFileReader::reap()
+{
+}
+
+void UringFileReader::waitFor(int /*slot*/)
+{
+}
+
+void UringFileReader::drain()
+{
+}
+
+void UringFileReader::restart(qint64 /*pos*/)
+{
+}
+
+bool UringFileReader::ensureData()
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef URINGFILEREADER_H
+#define URINGFILEREADER_H
+
+#include "cppCORE_global.h"
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+
+struct io_uring;
+
+/**
+  @brief Sequential reader for large local files based on Linux io_uring.
+
+  Several large reads are queued ahead into (registered) buffers, so that the device is kept busy while the data is processed.
+  The backend is optional: it is only compiled in with 'CONFIG+=io_uring' (requires liburing). Use isAvailable() and fall back to QFile otherwise.
+*/
+class CPPCORESHARED_EXPORT UringFileReader
+{
+public:
+	///Constructor. @p block_size is the size of a single read, @p queue_depth the number of reads that are queued ahead.
+	UringFileReader(QString filename, int block_size = 4*1048576, int queue_depth = 8);
+	///Destructor. Calls close().
+	~UringFileReader();
+
+	///Returns if io_uring support is compiled in and usable on this system (kernel support, seccomp/container restrictions).
+	static bool isAvailable();
+
+	///Opens the file and queues the first reads. Returns false if the file or the io_uring instance could not be set up.
+	bool open();
+	///Closes the file and releases the ring and buffers.
+	void close();
+	///Returns if the file is open.
+	bool isOpen() const
+	{
+		return fd_!=-1;
+	}
+
+	///Reads at most @p maxlen bytes.
+	QByteArray read(qint64 maxlen);
+	///Reads a line including the line ending.
+	QByteArray readLine();
+	///Returns if the end of the file is reached.
+	bool atEnd() const
+	{
+		return pos()>=file_size_;
+	}
+	///Returns the current position.
+	qint64 pos() const
+	{
+		return pos_;
+	}
+	///Sets the current position. Queued reads are discarded and the read-ahead restarts at the new position.
+	bool seek(qint64 pos);
+	///Returns the file size (determined when opening the file).
+	qint64 size() const
+	{
+		return file_size_;
+	}
+
+protected:
+	//state of a read buffer
+	enum SlotState
+	{
+		IDLE,
+		IN_FLIGHT,
+		READY
+	};
+	//read buffer with the file range it contains
+	struct Slot
+	{
+		char* buffer = nullptr;
+		qint64 offset = 0;
+		int requested = 0;
+		int bytes = 0;
+		int error = 0;
+		SlotState state = IDLE;
+	};
+
+	QString filename_;
+	int block_size_;
+	int queue_depth_;
+	int fd_;
+	qint64 file_size_;
+	io_uring* ring_;
+	bool buffers_registered_;
+	QVector<Slot> slots_;
+	int current_; //slot that is currently consumed
+	int current_pos_; //position inside the current slot
+	qint64 pos_; //logical file position
+	qint64 next_offset_; //file offset of the next read to queue
+
+	//queues a read for the given slot at 'next_offset_'
+	void submit(int slot);
+	//processes the next completed read
+	void reap();
+	//waits until the given slot contains data. Throws an exception if the read failed.
+	void waitFor(int slot);
+	//waits for all reads that are in flight
+	void drain();
+	//restarts the read-ahead at the given position
+	void restart(qint64 pos);
+	//makes sure the current slot has data to consume. Returns false at the end of the file.
+	bool ensureData();
+
+	//declared away methods
+	UringFileReader(const UringFileReader&) = delete;
+	UringFileReader& operator=(const UringFileReader&) = delete;
+};
+
+#endif // URINGFILEREADER_H
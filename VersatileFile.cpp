@@ -6,7 +6,14 @@
 #include "CustomProxyService.h"
 #include <QEventLoop>
 #include <QNetworkReply>
+#include <QtConcurrent>
 #include "Settings.h"
+#include <fcntl.h>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 VersatileFile::VersatileFile(QString file_name, bool stdin_if_empty)
 	: file_name_(file_name)
@@ -94,16 +101,28 @@ bool VersatileFile::open(QIODevice::OpenMode mode, bool throw_on_error)
 	}
 
 	bool opened = true;
-	if (mode_==LOCAL)
+	if (file_stream_pointer_!=nullptr)
 	{
-		if (file_stream_pointer_!=nullptr)
-		{
-			opened = local_source_.data()->open(file_stream_pointer_, mode);
-		}
-		else
+		opened = local_source_.data()->open(file_stream_pointer_, mode);
+		if (opened) detectStdinCompression();
+	}
+	else if (mode_==LOCAL)
+	{
+		//use io_uring reader for large files if available - fall back to QFile otherwise
+		if (UringFileReader::isAvailable() && QFileInfo(file_name_).size()>=uring_block_size_)
 		{
-			opened = local_source_.data()->open(mode);
+			uring_reader_ = QSharedPointer<UringFileReader>(new UringFileReader(file_name_, uring_block_size_, uring_queue_depth_));
+			if (uring_reader_->open())
+			{
+				uring_open_mode_ = mode;
+			}
+			else
+			{
+				uring_reader_.clear();
+			}
 		}
+
+		opened = usesUring() || local_source_.data()->open(mode);
 	}
 	else if (mode_==LOCAL_GZ)
 	{
@@ -134,6 +153,7 @@ QNetworkProxy VersatileFile::proxy() const
 
 QIODevice::OpenMode VersatileFile::openMode() const
 {
+	if (mode_==LOCAL && usesUring()) return uring_open_mode_;
 	if (mode_==LOCAL) return local_source_.data()->openMode();
 	return QFile::ReadOnly;
 }
@@ -152,6 +172,14 @@ void VersatileFile::setGzBufferSizeInternal(int bytes)
 	gz_buffer_size_internal_ = bytes;
 }
 
+void VersatileFile::setUringParameters(int block_size, int queue_depth)
+{
+	if (isOpen()) THROW(ProgrammingException, "setUringParameters cannot be used after opening the file!");
+
+	uring_block_size_ = block_size;
+	uring_queue_depth_ = queue_depth;
+}
+
 bool VersatileFile::isReadable() const
 {
 	if (mode_==LOCAL || mode_==LOCAL_GZ)
@@ -175,10 +203,25 @@ QByteArray VersatileFile::read(qint64 maxlen)
 {
 	if (!is_open_) THROW(ProgrammingException, QString(__FUNCTION__) + " called, on not open file '" + file_name_ + "!");
 
-	if (mode_==LOCAL)
+	if (mode_==LOCAL && usesUring())
+	{
+		QByteArray output = uring_reader_->read(maxlen);
+		uringTextConversion(output);
+		return output;
+	}
+	else if (mode_==LOCAL)
 	{
 		return local_source_.data()->read(maxlen);
 	}
+	else if (isStdinGz())
+	{
+		while (decompressed_buffer_.size()-decompressed_buffer_pos_ < maxlen && fillDecompressedBuffer()) {}
+
+		QByteArray output = decompressed_buffer_.mid(decompressed_buffer_pos_, maxlen);
+		decompressed_buffer_pos_ += output.size();
+		cursor_position_ += output.size();
+		return output;
+	}
 	else if (mode_==LOCAL_GZ)
 	{
 		THROW(NotImplementedException, "VersatileFile::read is not implemented for GZ files!");
@@ -226,7 +269,13 @@ QByteArray VersatileFile::readAll()
 {
     if (!is_open_) THROW(ProgrammingException, QString(__FUNCTION__) + " called, on not open file '" + file_name_ + "!");
 
-	if (mode_==LOCAL)
+	if (mode_==LOCAL && usesUring())
+	{
+		QByteArray output = uring_reader_->read(uring_reader_->size() - uring_reader_->pos());
+		uringTextConversion(output);
+		return output;
+	}
+	else if (mode_==LOCAL)
 	{
 		return local_source_.data()->readAll();
 	}
@@ -291,11 +340,16 @@ QByteArray VersatileFile::readLine(bool trim_line_endings)
 
 	QByteArray output;
 
-	if (mode_==LOCAL)
+	if (mode_==LOCAL && usesUring())
+	{
+		output = uring_reader_->readLine();
+		uringTextConversion(output);
+	}
+	else if (mode_==LOCAL)
 	{
 		output = local_source_.data()->readLine();
 	}
-	else if (mode_==LOCAL_GZ)
+	else if (mode_==LOCAL_GZ && !isStdinGz())
 	{
         // get next line
 		char* char_array = gzgets(gz_stream_, gz_buffer_, gz_buffer_size_);
@@ -313,7 +367,7 @@ QByteArray VersatileFile::readLine(bool trim_line_endings)
 
         output = QByteArray(char_array);
 	}
-	else if (mode_==URL_GZ)
+	else if (mode_==URL_GZ || isStdinGz())
 	{
 		while (true)
 		{
@@ -329,7 +383,7 @@ QByteArray VersatileFile::readLine(bool trim_line_endings)
 				break;
 			}
 
-			if (remote_gz_finished_)
+			if (!fillDecompressedBuffer())
 			{
 				if (decompressed_buffer_pos_ >= decompressed_buffer_.size()) return QByteArray();
 
@@ -338,22 +392,6 @@ QByteArray VersatileFile::readLine(bool trim_line_endings)
 				decompressed_buffer_pos_ = decompressed_buffer_.size();
 				break;
 			}
-
-			qint64 end = qMin(remote_position_ + chunkSize() - 1, size() - 1);			
-			QByteArray compressed_chunk = httpRangeRequest(remote_position_, end);
-			if (compressed_chunk.isEmpty())
-			{
-				remote_gz_finished_ = true;
-				continue;
-			}
-
-            remote_position_ += compressed_chunk.size();
-            for (int offset = 0; offset < compressed_chunk.size(); offset += max_compressed_chunk_size_)
-            {
-                QByteArray out;
-                if (!decompressor_.feed(compressed_chunk.mid(offset, max_compressed_chunk_size_), out)) THROW(ProgrammingException, "inflate failed for chunked data");
-                decompressed_buffer_.append(out);
-            }
 		}
 	}
 	else
@@ -410,10 +448,18 @@ bool VersatileFile::atEnd() const
 {
 	if (!is_open_) THROW(ProgrammingException, QString(__FUNCTION__) + " called, on not open file '" + file_name_ + "!");
 
-	if (mode_==LOCAL)
+	if (mode_==LOCAL && usesUring())
+	{
+		return uring_reader_->atEnd();
+	}
+	else if (mode_==LOCAL)
 	{
 		return local_source_.data()->atEnd();
 	}
+	else if (isStdinGz())
+	{
+		return local_source_.data()->atEnd() && (decompressed_buffer_pos_ >= decompressed_buffer_.size());
+	}
 	else if (mode_==LOCAL_GZ)
 	{
 		return gzeof(gz_stream_);
@@ -442,7 +488,15 @@ bool VersatileFile::exists()
 
 void VersatileFile::close()
 {
-	if (mode_==LOCAL)
+	abortAsync();
+	async_future_.waitForFinished(); //the worker thread might still read a chunk
+
+	if (usesUring())
+	{
+		uring_reader_.clear();
+		uring_open_mode_ = QIODevice::NotOpen;
+	}
+	if (mode_==LOCAL || file_stream_pointer_!=nullptr)
 	{
 		local_source_.data()->close();
 	}
@@ -475,7 +529,11 @@ qint64 VersatileFile::pos() const
 {
 	if (!is_open_) THROW(ProgrammingException, QString(__FUNCTION__) + " called, on not open file '" + file_name_ + "!");
 
-	if (mode_==LOCAL)
+	if (mode_==LOCAL && usesUring())
+	{
+		return uring_reader_->pos();
+	}
+	else if (mode_==LOCAL)
 	{
 		return local_source_.data()->pos();
 	}
@@ -491,10 +549,26 @@ bool VersatileFile::seek(qint64 pos)
 {
 	if (!is_open_) THROW(ProgrammingException, QString(__FUNCTION__) + " called, on not open file '" + file_name_ + "!");
 
-	if (mode_==LOCAL)
+	if (mode_==LOCAL && usesUring())
+	{
+		return uring_reader_->seek(pos);
+	}
+	else if (mode_==LOCAL)
 	{
 		return local_source_.data()->seek(pos);
 	}
+	else if (isStdinGz())
+	{
+		//stdin cannot be re-opened, but we can rewind as long as the decompressed buffer was not compacted yet
+		if (pos==0 && cursor_position_==decompressed_buffer_pos_)
+		{
+			decompressed_buffer_pos_ = 0;
+			cursor_position_ = 0;
+			return true;
+		}
+
+		THROW(NotImplementedException, "VersatileFile::seek is not implemented for gzipped stdin, only resetting to the beginning of the stream is supported (as long as no data was discarded from the buffer)!");
+	}
     else if ((mode_==LOCAL_GZ) || (mode_==URL_GZ))
 	{
         if (pos==0)
@@ -515,9 +589,61 @@ bool VersatileFile::seek(qint64 pos)
     return true;
 }
 
+bool VersatileFile::seekBgzf(qint64 virtual_offset)
+{
+	if (!is_open_) THROW(ProgrammingException, QString(__FUNCTION__) + " called, on not open file '" + file_name_ + "!");
+	if (mode_!=LOCAL_GZ || isStdinGz()) THROW(ProgrammingException, "VersatileFile::seekBgzf is only supported for local GZ files, but called for '" + file_name_ + "'!");
+	if (virtual_offset<0) return false;
+
+	qint64 block_offset = virtual_offset >> 16;
+	int block_pos = virtual_offset & 0xFFFF;
+
+	//open a new descriptor at the start of the block - BGZF blocks are independent GZ members, so decompression can start there
+#ifdef Q_OS_WIN
+	int fd = _wopen(file_name_.toStdWString().c_str(), _O_RDONLY|_O_BINARY);
+	if (fd==-1) return false;
+	if (_lseeki64(fd, block_offset, SEEK_SET)!=block_offset)
+	{
+		_close(fd);
+		return false;
+	}
+#else
+	int fd = ::open(file_name_.toUtf8().constData(), O_RDONLY);
+	if (fd==-1) return false;
+	if (lseek(fd, block_offset, SEEK_SET)!=block_offset)
+	{
+		::close(fd);
+		return false;
+	}
+#endif
+	gzFile gz_stream = gzdopen(fd, "rb");
+	if (!gz_stream)
+	{
+#ifdef Q_OS_WIN
+		_close(fd);
+#else
+		::close(fd);
+#endif
+		return false;
+	}
+	gzbuffer(gz_stream, gz_buffer_size_internal_);
+
+	if (gz_stream_!=nullptr) gzclose(gz_stream_);
+	gz_stream_ = gz_stream;
+
+	//skip to the position inside the block
+	if (block_pos>0 && gzread(gz_stream_, gz_buffer_, block_pos)!=block_pos) return false;
+
+	return true;
+}
+
 qint64 VersatileFile::size()
 {
-	if (mode_==LOCAL)
+	if (mode_==LOCAL && usesUring())
+	{
+		return uring_reader_->size();
+	}
+	else if (mode_==LOCAL)
 	{
 		return local_source_.data()->size();
 	}
@@ -555,6 +681,66 @@ QByteArray VersatileFile::httpRangeRequest(qint64 start, qint64 end)
     return data;
 }
 
+void VersatileFile::detectStdinCompression()
+{
+	mode_ = LOCAL;
+
+	//peek magic bytes - they stay in the buffer of the device and are returned by the next read
+	QByteArray magic = local_source_.data()->peek(4);
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(magic.constData());
+	if (magic.size()>=4 && data[0]==0x28 && data[1]==0xb5 && data[2]==0x2f && data[3]==0xfd)
+	{
+		THROW(FileParseException, "Zstandard-compressed input on stdin is not supported. Please decompress it with 'zstd -dc' first!");
+	}
+	if (magic.size()<2 || data[0]!=0x1f || data[1]!=0x8b) return;
+
+	//GZ/BGZF: decompress the raw stream (no line ending conversion on compressed data)
+	local_source_.data()->setTextModeEnabled(false);
+	mode_ = LOCAL_GZ;
+	decompressor_.reset();
+	decompressed_buffer_.clear();
+	decompressed_buffer_pos_ = 0;
+	cursor_position_ = 0;
+}
+
+bool VersatileFile::fillDecompressedBuffer()
+{
+	//get next compressed chunk
+	QByteArray compressed_chunk;
+	if (isStdinGz())
+	{
+		compressed_chunk = local_source_.data()->read(gz_buffer_size_);
+	}
+	else if (!remote_gz_finished_)
+	{
+		qint64 end = qMin(remote_position_ + chunkSize() - 1, size() - 1);
+		compressed_chunk = httpRangeRequest(remote_position_, end);
+		remote_position_ += compressed_chunk.size();
+	}
+	if (compressed_chunk.isEmpty())
+	{
+		remote_gz_finished_ = true;
+		return false;
+	}
+
+	//drop consumed data to keep memory bounded for long streams
+	if (decompressed_buffer_pos_ > decompressed_buffer_.size() / 2)
+	{
+		decompressed_buffer_ = decompressed_buffer_.mid(decompressed_buffer_pos_);
+		decompressed_buffer_pos_ = 0;
+	}
+
+	//decompress
+	for (int offset = 0; offset < compressed_chunk.size(); offset += max_compressed_chunk_size_)
+	{
+		QByteArray out;
+		if (!decompressor_.feed(compressed_chunk.mid(offset, max_compressed_chunk_size_), out)) THROW(FileParseException, "Error while decompressing GZ data of file '" + file_name_ + "'!");
+		decompressed_buffer_.append(out);
+	}
+
+	return true;
+}
+
 bool VersatileFile::isGzipped()
 {
 	//handle BAM files as plain text (they are actually GZ) to make BamReader::info() work
@@ -583,3 +769,171 @@ bool VersatileFile::isGzipped()
 	return data[0] == 0x1f && data[1] == 0x8b;
 }
 
+
+void VersatileFile::readAsync(qint64 chunk_size)
+{
+	if (!is_open_) THROW(ProgrammingException, QString(__FUNCTION__) + " called, on not open file '" + file_name_ + "!");
+	if (async_running_) THROW(ProgrammingException, QString(__FUNCTION__) + " called, but an asynchronous read is already running on file '" + file_name_ + "!");
+	if (chunk_size<=0) THROW(ArgumentException, "Invalid chunk size " + QString::number(chunk_size) + " in VersatileFile::readAsync!");
+
+	async_running_ = true;
+	async_chunk_size_ = chunk_size;
+	async_buffer_.clear();
+
+	if (mode_==LOCAL || mode_==LOCAL_GZ)
+	{
+		async_future_.waitForFinished(); //a chunk read of an aborted asynchronous read may still be in progress
+		async_pool_.setMaxThreadCount(1);
+		connect(&async_watcher_, &QFutureWatcher<QByteArray>::finished, this, &VersatileFile::processAsyncChunk, Qt::UniqueConnection);
+		readNextChunkAsync();
+		return;
+	}
+
+	//remote file: stream the content from the current position
+	if (mode_==URL_GZ && cursor_position_!=0)
+	{
+		async_running_ = false;
+		THROW(NotImplementedException, "VersatileFile::readAsync is only implemented from the start of remote GZ files!");
+	}
+	if (mode_==URL_GZ) decompressor_.reset();
+
+	QNetworkRequest request((QUrl(file_name_)));
+	request.setDecompressedSafetyCheckThreshold(-1);
+	request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+	if (cursor_position_>0) request.setRawHeader("Range", "bytes=" + QByteArray::number(cursor_position_) + "-");
+
+	async_reply_ = net_mgr_.get(request);
+	connect(async_reply_, &QNetworkReply::readyRead, this, &VersatileFile::processAsyncReply);
+	connect(async_reply_, &QNetworkReply::finished, this, [this]()
+	{
+		processAsyncReply();
+		if (!async_running_) return;
+
+		bool successful = async_reply_->error()==QNetworkReply::NoError;
+		QString error = successful ? "" : "Could not read file '" + file_name_ + "': " + async_reply_->errorString();
+		remote_gz_finished_ = successful;
+		async_reply_->deleteLater();
+		async_reply_ = nullptr;
+
+		if (successful && !async_buffer_.isEmpty())
+		{
+			QByteArray data = async_buffer_;
+			async_buffer_.clear();
+			emit chunkReady(data);
+		}
+		finishAsync(successful, error);
+	});
+}
+
+void VersatileFile::abortAsync()
+{
+	async_running_ = false;
+	async_buffer_.clear();
+
+	if (async_reply_!=nullptr)
+	{
+		disconnect(async_reply_, nullptr, this, nullptr);
+		async_reply_->abort();
+		async_reply_->deleteLater();
+		async_reply_ = nullptr;
+	}
+}
+
+void VersatileFile::readNextChunkAsync()
+{
+	//the worker thread is the only one accessing the file until the chunk is read (synchronous reads are not allowed during an asynchronous read)
+	async_future_ = QtConcurrent::run(&async_pool_, [this]()
+	{
+		QByteArray chunk;
+		try
+		{
+			if (mode_==LOCAL_GZ && !isStdinGz())
+			{
+				chunk.resize(async_chunk_size_);
+				int bytes = gzread(gz_stream_, chunk.data(), static_cast<unsigned int>(async_chunk_size_));
+				if (bytes<0)
+				{
+					int error_no = Z_OK;
+					QByteArray error_message = gzerror(gz_stream_, &error_no);
+					THROW(FileParseException, "Error while reading file '" + file_name_ + "': " + error_message);
+				}
+				chunk.resize(bytes);
+			}
+			else
+			{
+				chunk = read(async_chunk_size_);
+			}
+			async_error_.clear();
+		}
+		catch (Exception& e)
+		{
+			async_error_ = e.message();
+			chunk.clear();
+		}
+		return chunk;
+	});
+
+	//setting a new future discards pending notifications of the previous one
+	async_watcher_.setFuture(async_future_);
+}
+
+void VersatileFile::processAsyncChunk()
+{
+	if (!async_running_) return; //aborted
+
+	QByteArray chunk = async_future_.result();
+	if (!async_error_.isEmpty())
+	{
+		finishAsync(false, async_error_);
+		return;
+	}
+
+	if (!chunk.isEmpty()) emit chunkReady(chunk);
+	if (!async_running_) return; //aborted by a receiver of the chunk
+
+	if (chunk.isEmpty() || atEnd())
+	{
+		finishAsync(true, "");
+	}
+	else
+	{
+		readNextChunkAsync();
+	}
+}
+
+void VersatileFile::processAsyncReply()
+{
+	if (!async_running_ || async_reply_==nullptr) return;
+
+	QByteArray data = async_reply_->readAll();
+	if (data.isEmpty()) return;
+	remote_position_ += data.size();
+
+	if (mode_==URL_GZ)
+	{
+		QByteArray out;
+		if (!decompressor_.feed(data, out))
+		{
+			abortAsync();
+			emit readFinished(false, "Error while decompressing GZ data of file '" + file_name_ + "'!");
+			return;
+		}
+		data = out;
+	}
+	cursor_position_ += data.size();
+
+	async_buffer_.append(data);
+	if (async_buffer_.size()>=async_chunk_size_)
+	{
+		QByteArray chunk = async_buffer_;
+		async_buffer_.clear();
+		emit chunkReady(chunk);
+	}
+}
+
+void VersatileFile::finishAsync(bool successful, QString error)
+{
+	async_running_ = false;
+	async_buffer_.clear();
+	emit readFinished(successful, error);
+}
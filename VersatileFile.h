@@ -7,10 +7,17 @@
 #include <QSharedPointer>
 #include <QByteArray>
 #include <QObject>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QThreadPool>
 #include <zlib.h> //TODO Marc try libdeflate instead of zlib
 #include "GzipStreamDecompressor.h"
+#include "UringFileReader.h"
+
+class QNetworkReply;
 
 //File class that can handle plain text files, gzipped text files and URLs.
+//When reading from stdin, GZ/BGZF input is detected via its magic bytes and decompressed on the fly.
 //If you need QString output with proper handling of the encoding, use VersatileTextStream.
 class CPPCORESHARED_EXPORT VersatileFile
     : public QObject
@@ -43,6 +50,13 @@ public:
 	void setGzBufferSize(int bytes);
 	//set internal buffer size, i.e. the buffer that is internally used by zlib. Increasing this buffer should improve reading speed. Call before opening the file!
 	void setGzBufferSizeInternal(int bytes);
+	//set block size and read-ahead depth of the io_uring reader, which is used for large plain local files if available (see UringFileReader). Call before opening the file!
+	void setUringParameters(int block_size, int queue_depth);
+	//returns if the io_uring reader is used for the file.
+	bool usesUring() const
+	{
+		return !uring_reader_.isNull();
+	}
 
 	bool isOpen() const { return is_open_; }
 	bool isReadable() const;
@@ -57,6 +71,8 @@ public:
 
 	qint64 pos() const;
 	bool seek(qint64 pos);
+	//seeks to a virtual offset in a BGZF file (compressed block offset in the upper 48 bits, offset inside the uncompressed block in the lower 16 bits). Only for LOCAL_GZ mode.
+	bool seekBgzf(qint64 virtual_offset);
 	qint64 size();
 
 	QString fileName() const;
@@ -64,6 +80,26 @@ public:
 	//checks if a file is GZ or BGZ.
 	bool isGzipped();
 
+	//Starts reading the remaining file content asynchronously, i.e. without blocking the event loop or spinning a nested event loop (requires a running event loop).
+	//The data is delivered in chunks of roughly the given size via 'chunkReady' (decompressed for GZ files). 'readFinished' is emitted at the end or when an error occurs.
+	//Several files can be read concurrently from one thread this way. Do not use the synchronous read methods while an asynchronous read is running.
+	//Chunks of local files and stdin are read in a worker thread (one chunk at a time), so waiting for data from a pipe does not block the event loop.
+	//Note: close() waits for a chunk read that is in progress, i.e. for stdin until data is available or the stream ends.
+	void readAsync(qint64 chunk_size = 1048576);
+	//Aborts a running asynchronous read. 'readFinished' is not emitted in this case.
+	void abortAsync();
+	//Returns if an asynchronous read is running.
+	bool isReadingAsync() const
+	{
+		return async_running_;
+	}
+
+signals:
+	//Emitted for each chunk of data read by readAsync().
+	void chunkReady(QByteArray data);
+	//Emitted when the asynchronous read is finished. If it was not successful, the error message is given.
+	void readFinished(bool successful, QString error);
+
 private:
     QNetworkAccessManager net_mgr_;
 	QString file_name_;
@@ -73,6 +109,15 @@ private:
 
 	//members for LOCAL mode
 	QSharedPointer<QFile> local_source_;
+	QSharedPointer<UringFileReader> uring_reader_;
+	QIODevice::OpenMode uring_open_mode_ = QIODevice::NotOpen;
+	int uring_block_size_ = 4*1048576; //4MB reads
+	int uring_queue_depth_ = 8; //32MB read-ahead
+	//removes '\r' from data read by the io_uring reader in text mode (like QFile does)
+	void uringTextConversion(QByteArray& data) const
+	{
+		if (uring_open_mode_.testFlag(QIODevice::Text) && data.contains('\r')) data.replace("\r", "");
+	}
 
 	//members for LOCAL_GZ mode
 	int gz_buffer_size_ = 1048576; //1MB buffer
@@ -97,13 +142,42 @@ private:
     qint64 file_size_ = -1;
     bool file_exists_ = false;
 
-    //members for remote decompression
+    //members for remote decompression (also used for gzipped stdin)
     bool remote_gz_finished_ = false;
     QByteArray decompressed_buffer_;
     qint64 decompressed_buffer_pos_ = 0;
 
     //gets a chunk from the remote file
     QByteArray httpRangeRequest(qint64 start, qint64 end);
+
+	//members for gzipped stdin (uses the members for remote decompression)
+	//returns if the input is gzipped data read from stdin
+	bool isStdinGz() const
+	{
+		return mode_==LOCAL_GZ && file_stream_pointer_!=nullptr;
+	}
+	//checks the magic bytes of stdin and switches to LOCAL_GZ mode for gzipped input
+	void detectStdinCompression();
+	//reads and decompresses the next compressed chunk (URL_GZ or gzipped stdin). Returns false if there is no more data.
+	bool fillDecompressedBuffer();
+
+	//members for asynchronous reading
+	bool async_running_ = false;
+	qint64 async_chunk_size_ = 1048576;
+	QByteArray async_buffer_;
+	QNetworkReply* async_reply_ = nullptr;
+	QThreadPool async_pool_;
+	QFuture<QByteArray> async_future_;
+	QFutureWatcher<QByteArray> async_watcher_;
+	QString async_error_; //error of the last chunk read in the worker thread
+	//starts reading the next chunk of a local file (or stdin) in the worker thread
+	void readNextChunkAsync();
+	//handles a chunk read in the worker thread and starts reading the next one
+	void processAsyncChunk();
+	//handles data received by the asynchronous network request
+	void processAsyncReply();
+	//ends the asynchronous read and emits 'readFinished'
+	void finishAsync(bool successful, QString error);
 };
 
 
@@ -3,6 +3,8 @@ include("../lib.pri")
 #base settings
 QT       += gui widgets charts
 QT += network
+QT += concurrent
+QT += svg
 TARGET = cppCORE
 DEFINES += CPPCORE_LIBRARY
 
@@ -10,6 +12,12 @@ DEFINES += CPPCORE_LIBRARY
 SVN_VER= \\\"$$system(cd .. && git describe --tags)\\\"
 DEFINES += "CPPCORE_VERSION=$$SVN_VER"
 
+#optional io_uring reader for large local files (Linux only, requires liburing): qmake CONFIG+=io_uring
+linux:io_uring {
+    DEFINES += CPPCORE_IO_URING
+    LIBS += -luring
+}
+
 #get decryption key
 CRYPT_KEY= \\\"$$cat("CRYPT_KEY.txt", lines)\\\"
 DEFINES += "CRYPT_KEY=$$CRYPT_KEY"
@@ -37,7 +45,18 @@ SOURCES += \
     TSVFileStream.cpp \
     SimpleCrypt.cpp \
     TsvFile.cpp \
-    Git.cpp
+    Git.cpp \
+    UringFileReader.cpp \
+    TSVFileIndex.cpp \
+    TSVFileSorter.cpp \
+    TSVFileJoiner.cpp \
+    Arena.cpp \
+    StatisticsAccumulator.cpp \
+    QuantileSketch.cpp \
+    StatisticsKernels.cpp \
+    MultipleTesting.cpp \
+    PlotRenderer.cpp \
+    PlotRenderQueue.cpp
 
 HEADERS += ToolBase.h \
     BarPlot.h \
@@ -62,7 +81,19 @@ HEADERS += ToolBase.h \
     TSVFileStream.h \
     SimpleCrypt.h \
     TsvFile.h \
-    Git.h
+    Git.h \
+    UringFileReader.h \
+    TSVFileIndex.h \
+    TSVFileSorter.h \
+    TSVFileJoiner.h \
+    Arena.h \
+    StatisticsAccumulator.h \
+    QuantileSketch.h \
+    StatisticsKernels.h \
+    DataView.h \
+    MultipleTesting.h \
+    PlotRenderer.h \
+    PlotRenderQueue.h
 	
 
 RESOURCES += \